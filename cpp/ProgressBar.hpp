@@ -1,4 +1,11 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <iostream>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
 
 class nullstream : public std::ostream
 {
@@ -46,19 +53,160 @@ public:
   }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Multi-Threaded Progress Tracker
+//
+// Workers call add() from any thread: each thread bumps its own cache line
+// among 64 relaxed atomic counters, and nothing else happens on the hot
+// path. A renderer thread sums the counters at a fixed period and prints the
+// percentage, throughput and ETA on a single line. With a nullstream the
+// renderer and all formatting are compiled out, leaving the counters.
+
+class ProgressCounters
+{
+public:
+  enum { shards = 64 };
+
+  ProgressCounters()
+  {
+    for (int i = 0; i < shards; ++i) counters[i].value.store(0, std::memory_order_relaxed);
+  }
+
+  void add(uint64_t n = 1)
+  {
+    counters[shard()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void operator++() { add(1); }
+  void operator+=(uint64_t n) { add(n); }
+
+  // Sum of the counters, a snapshot as of some recent point.
+  uint64_t count() const
+  {
+    uint64_t n = 0;
+    for (int i = 0; i < shards; ++i) n += counters[i].value.load(std::memory_order_relaxed);
+    return n;
+  }
+
+private:
+  struct alignas(64) counter { std::atomic<uint64_t> value; };
+  counter counters[shards];
+
+  // threads are given shards round-robin, on their first add()
+  static unsigned shard()
+  {
+    static std::atomic<unsigned> next(0);
+    static thread_local unsigned index = next.fetch_add(1, std::memory_order_relaxed) % shards;
+    return index;
+  }
+};
+
+///
+
+template<typename Stream = std::ostream>
+class ProgressTracker : public ProgressCounters
+{
+  typedef std::chrono::steady_clock clock;
+
+  Stream& os;
+  const uint64_t total;
+  const clock::time_point start;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  bool stopped;
+  std::thread renderer;
+
+public:
+  ProgressTracker(Stream& o, uint64_t t, std::chrono::milliseconds period = std::chrono::milliseconds(100))
+    : os(o), total(t), start(clock::now()), stopped(false)
+  {
+    renderer = std::thread([this, period]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (!wakeup.wait_for(lock, period, [this]() { return stopped; })) render();
+    });
+  }
+
+  ~ProgressTracker()
+  {
+    done();
+  }
+
+  // Stops the renderer after a last update; called by the destructor.
+  void done()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stopped) return;
+      stopped = true;
+    }
+    wakeup.notify_one();
+    renderer.join();
+    render();
+    os << std::endl;
+  }
+
+private:
+  void render()
+  {
+    const uint64_t n = count();
+    const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    const double rate = (elapsed > 0 ? n / elapsed : 0);
+    const long eta = (rate > 0 && n < total ? (long) ((total - n) / rate) : 0);
+    char line[96];
+    std::snprintf(line, sizeof(line), "\r%5.1f%% %10.4g items/s ETA %02ld:%02ld:%02ld",
+                  (total ? 100.0 * n / total : 100.0), rate, eta / 3600, eta / 60 % 60, eta % 60);
+    os << line << std::flush;
+  }
+};
+
+// Counting only: no renderer thread and no output.
+template<>
+class ProgressTracker<nullstream> : public ProgressCounters
+{
+public:
+  ProgressTracker(nullstream&, uint64_t, std::chrono::milliseconds = std::chrono::milliseconds(100)) {}
+  void done() {}
+};
+
 #ifdef DEMO
 #include <unistd.h>
+#include <vector>
+
+// counts threads x max x 10^6 items, with a tracker writing to Stream
+template<typename Stream>
+double track(Stream& os, int max, unsigned threads)
+{
+  const uint64_t items = (uint64_t) max * 1000000;
+  const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  ProgressTracker<Stream> tracker(os, threads * items);
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.push_back(std::thread([&tracker, items]() {
+      for (uint64_t i = 0; i < items; ++i) ++tracker;
+    }));
+  }
+  for (unsigned t = 0; t < threads; ++t) workers[t].join();
+  tracker.done();
+  if (tracker.count() != threads * items) std::cout << "oops!" << std::endl;
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
 
 int main(int argc, char* argv[])
 {
   const int max = (argc > 1 ? atoi(argv[1]) : 100);
   const int delay = (argc > 2 ? atoi(argv[2]) * 1000 : 100000);
+  const unsigned threads = (argc > 3 ? atoi(argv[3]) : std::thread::hardware_concurrency());
   int count = 0;
   for (ProgressBar i(std::cout, max); i; ++i) {
     ++count;
     usleep(delay);
   }
   std::cout << "\ncount = " << count << std::endl;
+
+  const double rendered = track(std::cout, max, threads);
+  nullstream null;
+  const double silent = track(null, max, threads);
+  std::cout << threads << " threads : " << rendered << " s rendered, " << silent << " s with nullstream" << std::endl;
   return 0;
 }
 #endif
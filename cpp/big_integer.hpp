@@ -0,0 +1,783 @@
+#ifndef _PADS_BIG_INTEGER_H_
+#define _PADS_BIG_INTEGER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "integer.hpp"
+
+namespace pads {
+namespace math {
+
+////////////////////////////////////////////////////////////////////////////////
+// Magnitude Arithmetic
+//
+// Unsigned numbers are arrays of 64-bit limbs, least significant first. The
+// functions below do not allocate unless noted and do not trim leading zeros.
+
+namespace detail {
+
+typedef unsigned long long limb;
+typedef unsigned __int128 dlimb;
+
+enum { karatsuba_threshold = 32 }; // limbs
+
+// r = a + b (n limbs each), returns the carry; r may alias a or b.
+inline limb add_n(limb* r, const limb* a, const limb* b, size_t n)
+{
+  limb c = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const dlimb s = (dlimb) a[i] + b[i] + c;
+    r[i] = (limb) s;
+    c = (limb) (s >> 64);
+  }
+  return c;
+}
+
+// r = a + b for na >= nb, returns the carry; r may alias a or b.
+inline limb add(limb* r, const limb* a, size_t na, const limb* b, size_t nb)
+{
+  limb c = add_n(r, a, b, nb);
+  for (size_t i = nb; i < na; ++i) {
+    const limb s = a[i] + c;
+    c = (s < c);
+    r[i] = s;
+  }
+  return c;
+}
+
+// r = a - b (n limbs each), returns the borrow; r may alias a or b.
+inline limb sub_n(limb* r, const limb* a, const limb* b, size_t n)
+{
+  limb c = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const limb x = a[i], y = b[i];
+    r[i] = x - y - c;
+    c = (x < y) | (x - y < c);
+  }
+  return c;
+}
+
+// r = a - b for na >= nb, returns the borrow; r may alias a or b.
+inline limb sub(limb* r, const limb* a, size_t na, const limb* b, size_t nb)
+{
+  limb c = sub_n(r, a, b, nb);
+  for (size_t i = nb; i < na; ++i) {
+    const limb x = a[i];
+    r[i] = x - c;
+    c = (x < c);
+  }
+  return c;
+}
+
+// Compares two magnitudes without leading zeros.
+inline int cmp(const limb* a, size_t na, const limb* b, size_t nb)
+{
+  if (na != nb) return (na < nb ? -1 : 1);
+  for (size_t i = na; i--; ) {
+    if (a[i] != b[i]) return (a[i] < b[i] ? -1 : 1);
+  }
+  return 0;
+}
+
+// r += a * m (n limbs), returns the carry limb.
+inline limb addmul_1(limb* r, const limb* a, size_t n, limb m)
+{
+  limb c = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const dlimb t = (dlimb) a[i] * m + r[i] + c;
+    r[i] = (limb) t;
+    c = (limb) (t >> 64);
+  }
+  return c;
+}
+
+// r = a << s for 0 <= s < 64, returns the bits shifted out; r may alias a,
+// or overlap it at higher addresses (the limbs are moved from the top).
+inline limb lshift(limb* r, const limb* a, size_t n, int s)
+{
+  if (!n) return 0;
+  if (!s) {
+    std::copy_backward(a, a + n, r + n);
+    return 0;
+  }
+  const limb out = a[n-1] >> (64 - s);
+  for (size_t i = n - 1; i; --i) {
+    r[i] = (a[i] << s) | (a[i-1] >> (64 - s));
+  }
+  r[0] = a[0] << s;
+  return out;
+}
+
+// r = a >> s for 0 <= s < 64; r may alias a, or overlap it at lower addresses.
+inline void rshift(limb* r, const limb* a, size_t n, int s)
+{
+  if (!s) {
+    std::copy(a, a + n, r);
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    r[i] = (a[i] >> s) | (i + 1 < n ? a[i+1] << (64 - s) : 0);
+  }
+}
+
+// Schoolbook multiplication: r = a * b (na + nb limbs), r not aliasing a or b.
+inline void mul_basecase(limb* r, const limb* a, size_t na, const limb* b, size_t nb)
+{
+  std::fill(r, r + na + nb, 0);
+  for (size_t j = 0; j < nb; ++j) {
+    r[na + j] = addmul_1(r + j, a, na, b[j]);
+  }
+}
+
+// r = a * b (na + nb limbs) for na >= nb >= 1, r not aliasing a or b.
+// Karatsuba above the threshold: with a = a1 B^m + a0 and b = b1 B^m + b0,
+// a b = z2 B^2m + ((a0 + a1)(b0 + b1) - z2 - z0) B^m + z0 in 3 products.
+inline void mul(limb* r, const limb* a, size_t na, const limb* b, size_t nb)
+{
+  if (nb < karatsuba_threshold) {
+    mul_basecase(r, a, na, b, nb);
+    return;
+  }
+
+  const size_t m = (na + 1) / 2;
+  if (nb <= m) {
+    // unbalanced: a is cut into nb-limb slices
+    std::fill(r, r + na + nb, 0);
+    std::vector<limb> t(2 * nb);
+    for (size_t i = 0; i < na; i += nb) {
+      const size_t k = std::min(nb, na - i);
+      if (k == nb) {
+        mul(&t[0], a + i, k, b, nb);
+      } else {
+        mul(&t[0], b, nb, a + i, k);
+      }
+      limb c = add(r + i, r + i, k + nb, &t[0], k + nb);
+      for (size_t j = i + k + nb; c; ++j) {
+        c = ((r[j] += c) < c);
+      }
+    }
+    return;
+  }
+
+  const size_t ha = na - m, hb = nb - m;
+  mul(r, a, m, b, m);
+  mul(r + 2 * m, a + m, ha, b + m, hb);
+
+  std::vector<limb> sa(m + 1), sb(m + 1), z1(2 * m + 2);
+  sa[m] = add(&sa[0], a, m, a + m, ha);
+  sb[m] = add(&sb[0], b, m, b + m, hb);
+  mul(&z1[0], &sa[0], m + 1, &sb[0], m + 1);
+  sub(&z1[0], &z1[0], 2 * m + 2, r, 2 * m);
+  sub(&z1[0], &z1[0], 2 * m + 2, r + 2 * m, ha + hb);
+
+  size_t n1 = 2 * m + 2;
+  while (n1 && !z1[n1-1]) --n1;
+  if (n1) add(r + m, r + m, na + nb - m, &z1[0], n1);
+}
+
+// q = a / d (n limbs), returns a % d.
+inline limb divrem_1(limb* q, const limb* a, size_t n, limb d)
+{
+  dlimb r = 0;
+  for (size_t i = n; i--; ) {
+    const dlimb x = (r << 64) | a[i];
+    q[i] = (limb) (x / d);
+    r = x % d;
+  }
+  return (limb) r;
+}
+
+// Knuth's algorithm D: q = a / b (na - nb + 1 limbs) and r = a % b (nb
+// limbs), for na >= nb >= 2 and b without leading zeros. Allocates.
+inline void divrem(limb* q, limb* r, const limb* a, size_t na, const limb* b, size_t nb)
+{
+  const int s = __builtin_clzll(b[nb-1]);
+  std::vector<limb> u(na + 1), v(nb);
+  lshift(&v[0], b, nb, s);
+  u[na] = lshift(&u[0], a, na, s);
+
+  const limb v1 = v[nb-1], v2 = v[nb-2];
+  for (size_t j = na - nb + 1; j--; ) {
+    // estimate the quotient limb from the top two limbs, then correct it
+    const dlimb top = ((dlimb) u[j+nb] << 64) | u[j+nb-1];
+    dlimb qhat = top / v1, rhat = top % v1;
+    while (qhat >> 64 || qhat * v2 > ((rhat << 64) | u[j+nb-2])) {
+      --qhat;
+      rhat += v1;
+      if (rhat >> 64) break;
+    }
+
+    // u[j..j+nb] -= qhat * v
+    limb mc = 0, bc = 0;
+    for (size_t i = 0; i < nb; ++i) {
+      const dlimb p = (dlimb) (limb) qhat * v[i] + mc;
+      mc = (limb) (p >> 64);
+      const limb x = u[i+j], y = (limb) p;
+      u[i+j] = x - y - bc;
+      bc = (x < y) | (x - y < bc);
+    }
+    const limb x = u[j+nb];
+    u[j+nb] = x - mc - bc;
+    bc = (x < mc) | (x - mc < bc);
+
+    if (bc) { // qhat was one too large: add v back
+      --qhat;
+      u[j+nb] += add_n(&u[j], &u[j], &v[0], nb);
+    }
+    q[j] = (limb) qhat;
+  }
+  rshift(r, &u[0], nb, s);
+}
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+// Arbitrary-Precision Integer
+//
+// Sign and magnitude. Values of up to inline_limbs limbs (the product of two
+// words included) are stored in the object itself and never allocate.
+// Division truncates toward zero like the built-in types, and shifts act on
+// the magnitude.
+
+class big_integer
+{
+public:
+  typedef detail::limb limb;
+  enum { inline_limbs = 2 };
+
+  big_integer(long long v = 0)
+    : d(local), length(0), capacity(inline_limbs), negative(v < 0)
+  {
+    if (v) {
+      d[0] = (v < 0 ? 0 - (limb) v : (limb) v);
+      length = 1;
+    }
+  }
+
+  // Decimal, or hexadecimal with a 0x prefix, with an optional minus sign.
+  explicit big_integer(const std::string& s)
+    : d(local), length(0), capacity(inline_limbs), negative(false)
+  {
+    size_t i = (!s.empty() && (s[0] == '-' || s[0] == '+'));
+    const bool minus = (i && s[0] == '-');
+    if (s.compare(i, 2, "0x") == 0 || s.compare(i, 2, "0X") == 0) {
+      for (i += 2; i < s.size(); ++i) {
+        const int x = digit(s[i]);
+        if (x < 0 || x > 15) throw std::invalid_argument("big_integer: " + s);
+        *this <<= 4;
+        add_small(x);
+      }
+    } else {
+      if (i == s.size()) throw std::invalid_argument("big_integer: " + s);
+      // 19 decimal digits at a time
+      while (i < s.size()) {
+        limb chunk = 0, scale = 1;
+        for (int k = 0; k < 19 && i < s.size(); ++k, ++i) {
+          const int x = digit(s[i]);
+          if (x < 0 || x > 9) throw std::invalid_argument("big_integer: " + s);
+          chunk = chunk * 10 + x;
+          scale *= 10;
+        }
+        mul_small(scale);
+        add_small(chunk);
+      }
+    }
+    negative = minus && length;
+  }
+
+  big_integer(const big_integer& rhs)
+    : d(local), length(0), capacity(inline_limbs), negative(rhs.negative)
+  {
+    assign(rhs.d, rhs.length);
+  }
+
+  big_integer(big_integer&& rhs)
+    : d(local), length(0), capacity(inline_limbs), negative(rhs.negative)
+  {
+    if (rhs.d != rhs.local) {
+      d = rhs.d;
+      capacity = rhs.capacity;
+      rhs.d = rhs.local;
+      rhs.capacity = inline_limbs;
+    } else {
+      std::copy(rhs.d, rhs.d + rhs.length, d);
+    }
+    length = rhs.length;
+    rhs.length = 0;
+    rhs.negative = false;
+  }
+
+  big_integer& operator=(const big_integer& rhs)
+  {
+    if (this != &rhs) {
+      assign(rhs.d, rhs.length);
+      negative = rhs.negative;
+    }
+    return *this;
+  }
+
+  big_integer& operator=(big_integer&& rhs)
+  {
+    if (this != &rhs) {
+      if (rhs.d != rhs.local) {
+        if (d != local) delete[] d;
+        d = rhs.d;
+        capacity = rhs.capacity;
+        length = rhs.length;
+        rhs.d = rhs.local;
+        rhs.capacity = inline_limbs;
+      } else {
+        assign(rhs.d, rhs.length);
+      }
+      negative = rhs.negative;
+      rhs.length = 0;
+      rhs.negative = false;
+    }
+    return *this;
+  }
+
+  ~big_integer()
+  {
+    if (d != local) delete[] d;
+  }
+
+public:
+  bool is_zero() const { return !length; }
+  bool is_negative() const { return negative; }
+  bool is_odd() const { return length && (d[0] & 1); }
+  int sign() const { return (negative ? -1 : length ? 1 : 0); }
+
+  // Limbs of the magnitude, least significant first, without leading zeros.
+  const limb* data() const { return d; }
+  size_t size() const { return length; }
+
+  // Number of significant bits of the magnitude.
+  size_t bits() const
+  {
+    return (length ? 64 * length - __builtin_clzll(d[length-1]) : 0);
+  }
+
+  bool bit(size_t i) const
+  {
+    return i / 64 < length && ((d[i / 64] >> (i % 64)) & 1);
+  }
+
+  // Number of trailing zero bits of the magnitude (0 for zero).
+  size_t ctz() const
+  {
+    size_t i = 0;
+    while (i < length && !d[i]) ++i;
+    return (i < length ? 64 * i + __builtin_ctzll(d[i]) : 0);
+  }
+
+  bool fits_integer() const
+  {
+    return length == 0 || (length == 1 && (d[0] >> 63 == 0 || (negative && d[0] == (limb) 1 << 63)));
+  }
+
+  integer to_integer() const
+  {
+    if (!fits_integer()) throw std::overflow_error("big_integer does not fit in an integer");
+    return (length ? (negative ? (integer) (0 - d[0]) : (integer) d[0]) : 0);
+  }
+
+  std::string to_string() const
+  {
+    if (!length) return "0";
+    std::string s;
+    std::vector<limb> q(d, d + length);
+    size_t n = length;
+    while (n) {
+      limb r = detail::divrem_1(&q[0], &q[0], n, 10000000000000000000ULL);
+      while (n && !q[n-1]) --n;
+      for (int k = 0; k < 19 && (n || r); ++k, r /= 10) s += (char) ('0' + r % 10);
+    }
+    if (negative) s += '-';
+    std::reverse(s.begin(), s.end());
+    return s;
+  }
+
+public:
+  big_integer operator-() const
+  {
+    big_integer r(*this);
+    r.negative = !negative && length;
+    return r;
+  }
+
+  big_integer& operator+=(const big_integer& rhs) { add(rhs, rhs.negative); return *this; }
+  big_integer& operator-=(const big_integer& rhs) { add(rhs, !rhs.negative); return *this; }
+
+  big_integer& operator*=(const big_integer& rhs)
+  {
+    if (!length || !rhs.length) return *this = 0;
+    if (length == 1 && rhs.length == 1) { // word fast path
+      const detail::dlimb p = (detail::dlimb) d[0] * rhs.d[0];
+      d[0] = (limb) p;
+      d[1] = (limb) (p >> 64);
+      length = (d[1] ? 2 : 1);
+    } else {
+      big_integer r;
+      r.resize(length + rhs.length);
+      if (length >= rhs.length) {
+        detail::mul(r.d, d, length, rhs.d, rhs.length);
+      } else {
+        detail::mul(r.d, rhs.d, rhs.length, d, length);
+      }
+      r.trim();
+      swap(r);
+    }
+    negative = (negative != rhs.negative);
+    return *this;
+  }
+
+  big_integer& operator/=(const big_integer& rhs)
+  {
+    big_integer q, r;
+    divmod(*this, rhs, q, r);
+    return *this = std::move(q);
+  }
+
+  big_integer& operator%=(const big_integer& rhs)
+  {
+    big_integer q, r;
+    divmod(*this, rhs, q, r);
+    return *this = std::move(r);
+  }
+
+  big_integer& operator<<=(size_t s)
+  {
+    if (!length) return *this;
+    const size_t w = s / 64, n = length;
+    resize(n + w + 1);
+    d[n + w] = detail::lshift(d + w, d, n, s % 64);
+    std::fill(d, d + w, 0);
+    trim();
+    return *this;
+  }
+
+  big_integer& operator>>=(size_t s)
+  {
+    const size_t w = s / 64;
+    if (w >= length) return *this = 0;
+    detail::rshift(d, d + w, length - w, s % 64);
+    length -= w;
+    trim();
+    return *this;
+  }
+
+  big_integer& operator++() { return *this += 1; }
+  big_integer& operator--() { return *this -= 1; }
+
+  // q = a / b truncated toward zero, r = a - q * b (with the sign of a).
+  static void divmod(const big_integer& a, const big_integer& b, big_integer& q, big_integer& r)
+  {
+    if (!b.length) throw std::domain_error("big_integer division by zero");
+    if (detail::cmp(a.d, a.length, b.d, b.length) < 0) {
+      r = a;
+      q = 0;
+      return;
+    }
+    big_integer qq, rr;
+    qq.resize(a.length - b.length + 1);
+    if (b.length == 1) {
+      rr = (long long) 0;
+      rr.resize(1);
+      rr.d[0] = detail::divrem_1(qq.d, a.d, a.length, b.d[0]);
+    } else {
+      rr.resize(b.length);
+      detail::divrem(qq.d, rr.d, a.d, a.length, b.d, b.length);
+    }
+    qq.trim();
+    rr.trim();
+    qq.negative = qq.length && (a.negative != b.negative);
+    rr.negative = rr.length && a.negative;
+    q = std::move(qq);
+    r = std::move(rr);
+  }
+
+  void swap(big_integer& rhs)
+  {
+    big_integer t(std::move(rhs));
+    rhs = std::move(*this);
+    *this = std::move(t);
+  }
+
+  friend int compare(const big_integer& a, const big_integer& b)
+  {
+    if (a.negative != b.negative) return (a.negative ? -1 : 1);
+    const int c = detail::cmp(a.d, a.length, b.d, b.length);
+    return (a.negative ? -c : c);
+  }
+
+  friend big_integer gcd(const big_integer& x, const big_integer& y);
+  friend big_integer modexp(const big_integer& a, const big_integer& b, const big_integer& n);
+
+private:
+  limb* d;
+  unsigned length;   // limbs in use, d[length-1] != 0
+  unsigned capacity; // limbs allocated
+  bool negative;     // never set for zero
+  limb local[inline_limbs];
+
+  static int digit(char c)
+  {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  void reserve(size_t n)
+  {
+    if (n <= capacity) return;
+    const size_t c = std::max(n, 2 * (size_t) capacity);
+    limb* p = new limb[c];
+    std::copy(d, d + length, p);
+    if (d != local) delete[] d;
+    d = p;
+    capacity = c;
+  }
+
+  // Grows (zero filled) or shrinks the magnitude, without trimming.
+  void resize(size_t n)
+  {
+    reserve(n);
+    if (n > length) std::fill(d + length, d + n, 0);
+    length = n;
+  }
+
+  void trim()
+  {
+    while (length && !d[length-1]) --length;
+    if (!length) negative = false;
+  }
+
+  void assign(const limb* p, size_t n)
+  {
+    length = 0;
+    reserve(n);
+    std::copy(p, p + n, d);
+    length = n;
+  }
+
+  void add_small(limb x)
+  {
+    const size_t n = length;
+    resize(n + 1);
+    detail::add(d, d, n + 1, &x, 1);
+    trim();
+  }
+
+  void mul_small(limb x)
+  {
+    const size_t n = length;
+    resize(n + 1);
+    limb c = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const detail::dlimb p = (detail::dlimb) d[i] * x + c;
+      d[i] = (limb) p;
+      c = (limb) (p >> 64);
+    }
+    d[n] = c;
+    trim();
+  }
+
+  // *this += (-1)^minus |rhs|
+  void add(const big_integer& rhs, bool minus)
+  {
+    if (negative == minus) {
+      const size_t n = std::max(length, rhs.length);
+      if (this == &rhs) {
+        return (void) (*this <<= 1);
+      }
+      resize(n + 1);
+      d[n] = detail::add(d, d, n, rhs.d, rhs.length);
+    } else if (detail::cmp(d, length, rhs.d, rhs.length) >= 0) {
+      detail::sub(d, d, length, rhs.d, rhs.length);
+    } else {
+      big_integer t(rhs);
+      detail::sub(t.d, t.d, t.length, d, length);
+      t.negative = minus;
+      swap(t);
+    }
+    trim();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Operators
+
+inline big_integer operator+(big_integer a, const big_integer& b) { return a += b; }
+inline big_integer operator-(big_integer a, const big_integer& b) { return a -= b; }
+inline big_integer operator*(big_integer a, const big_integer& b) { return a *= b; }
+inline big_integer operator/(big_integer a, const big_integer& b) { return a /= b; }
+inline big_integer operator%(big_integer a, const big_integer& b) { return a %= b; }
+inline big_integer operator<<(big_integer a, size_t s) { return a <<= s; }
+inline big_integer operator>>(big_integer a, size_t s) { return a >>= s; }
+
+inline bool operator==(const big_integer& a, const big_integer& b) { return compare(a, b) == 0; }
+inline bool operator!=(const big_integer& a, const big_integer& b) { return compare(a, b) != 0; }
+inline bool operator<(const big_integer& a, const big_integer& b) { return compare(a, b) < 0; }
+inline bool operator>(const big_integer& a, const big_integer& b) { return compare(a, b) > 0; }
+inline bool operator<=(const big_integer& a, const big_integer& b) { return compare(a, b) <= 0; }
+inline bool operator>=(const big_integer& a, const big_integer& b) { return compare(a, b) >= 0; }
+
+inline bool odd(const big_integer& n) { return n.is_odd(); }
+inline bool even(const big_integer& n) { return !n.is_odd(); }
+inline big_integer abs(const big_integer& n) { return (n.is_negative() ? -n : n); }
+inline big_integer mulmod(const big_integer& a, const big_integer& b, const big_integer& n) { return a * b % n; }
+
+/// GCD ///
+
+// Binary GCD on the magnitudes, finished with word arithmetic once both fit.
+inline big_integer gcd(const big_integer& x, const big_integer& y)
+{
+  big_integer a = abs(x), b = abs(y);
+  if (a.is_zero()) return b;
+  if (b.is_zero()) return a;
+  const size_t shift = std::min(a.ctz(), b.ctz());
+  a >>= a.ctz();
+  do {
+    b >>= b.ctz();
+    if (a.length == 1 && b.length == 1) {
+      unsigned long long u = a.d[0], v = b.d[0];
+      while (v) {
+        v >>= __builtin_ctzll(v);
+        if (u > v) std::swap(u, v);
+        v -= u;
+      }
+      a.d[0] = u;
+      break;
+    }
+    if (detail::cmp(a.d, a.length, b.d, b.length) > 0) a.swap(b);
+    detail::sub(b.d, b.d, b.length, a.d, a.length);
+    b.trim();
+  } while (b.length);
+  return a <<= shift;
+}
+
+/// Modular Exponentiation ///
+
+namespace detail {
+
+// Montgomery multiplication modulo an odd n of k limbs (CIOS): r = a b / B^k
+// mod n, for a, b < n. t is scratch space of k + 2 limbs; r may alias a or b.
+inline void mont_mul(limb* r, const limb* a, const limb* b, const limb* n, size_t k, limb ninv, limb* t)
+{
+  std::fill(t, t + k + 2, 0);
+  for (size_t i = 0; i < k; ++i) {
+    limb c = 0;
+    for (size_t j = 0; j < k; ++j) {
+      const dlimb s = (dlimb) a[j] * b[i] + t[j] + c;
+      t[j] = (limb) s;
+      c = (limb) (s >> 64);
+    }
+    dlimb s = (dlimb) t[k] + c;
+    t[k] = (limb) s;
+    t[k+1] = (limb) (s >> 64);
+
+    const limb m = t[0] * ninv;
+    s = (dlimb) m * n[0] + t[0];
+    c = (limb) (s >> 64);
+    for (size_t j = 1; j < k; ++j) {
+      s = (dlimb) m * n[j] + t[j] + c;
+      t[j-1] = (limb) s;
+      c = (limb) (s >> 64);
+    }
+    s = (dlimb) t[k] + c;
+    t[k-1] = (limb) s;
+    t[k] = t[k+1] + (limb) (s >> 64);
+  }
+  if (t[k] || cmp(t, k, n, k) >= 0) {
+    sub_n(t, t, n, k);
+  }
+  std::copy(t, t + k, r);
+}
+
+} // namespace detail
+
+// Returns a^b mod n for b >= 0 and n > 0. Odd moduli use Montgomery
+// multiplication and a sliding window over the exponent; even ones fall
+// back to square and multiply with divisions.
+inline big_integer modexp(const big_integer& a, const big_integer& b, const big_integer& n)
+{
+  typedef detail::limb limb;
+  if (n.sign() <= 0) throw std::domain_error("modexp: modulus must be positive");
+  if (b.is_negative()) throw std::domain_error("modexp: negative exponent");
+  if (n == 1) return 0;
+
+  big_integer x = a % n;
+  if (x.is_negative()) x += n;
+
+  if (!n.is_odd()) {
+    big_integer r = 1;
+    for (size_t i = b.bits(); i--; ) {
+      r = r * r % n;
+      if (b.bit(i)) r = r * x % n;
+    }
+    return r;
+  }
+
+  const size_t k = n.length;
+  limb ninv = n.d[0]; // -n^-1 mod 2^64 by Newton iteration
+  for (int i = 0; i < 5; ++i) ninv *= 2 - n.d[0] * ninv;
+  ninv = 0 - ninv;
+
+  // window size minimizing squarings plus multiplications for this exponent
+  const size_t bits = b.bits();
+  const int w = (bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : 1);
+  const size_t powers = (size_t) 1 << (w - 1);
+
+  // g[i] = x^(2i+1) in Montgomery form
+  std::vector<limb> g(powers * k), sq(k), t(k + 2), r(k);
+  big_integer m = (x << (64 * k)) % n;
+  std::copy(m.d, m.d + m.length, &g[0]);
+  detail::mont_mul(&sq[0], &g[0], &g[0], n.d, k, ninv, &t[0]);
+  for (size_t i = 1; i < powers; ++i) {
+    detail::mont_mul(&g[i*k], &g[(i-1)*k], &sq[0], n.d, k, ninv, &t[0]);
+  }
+
+  bool one = true; // r is still 1, left implicit
+  for (size_t i = bits; i--; ) {
+    if (!b.bit(i)) {
+      if (!one) detail::mont_mul(&r[0], &r[0], &r[0], n.d, k, ninv, &t[0]);
+      continue;
+    }
+    // longest odd window b[j..i] of at most w bits
+    size_t j = (i + 1 >= (size_t) w ? i + 1 - w : 0);
+    while (!b.bit(j)) ++j;
+    size_t v = 0;
+    for (size_t l = i + 1; l-- > j; ) v = 2 * v + b.bit(l);
+    if (one) {
+      std::copy(&g[(v/2)*k], &g[(v/2)*k] + k, &r[0]);
+      one = false;
+    } else {
+      for (size_t l = j; l <= i; ++l) detail::mont_mul(&r[0], &r[0], &r[0], n.d, k, ninv, &t[0]);
+      detail::mont_mul(&r[0], &r[0], &g[(v/2)*k], n.d, k, ninv, &t[0]);
+    }
+    i = j;
+  }
+  if (one) return 1;
+
+  // back from Montgomery form: multiply by 1
+  std::fill(sq.begin(), sq.end(), 0);
+  sq[0] = 1;
+  detail::mont_mul(&r[0], &r[0], &sq[0], n.d, k, ninv, &t[0]);
+  big_integer result;
+  result.assign(&r[0], k);
+  result.trim();
+  return result;
+}
+
+} // namespace math
+} // namespace pads
+
+inline std::ostream& operator<<(std::ostream& os, const pads::math::big_integer& n) { return os << n.to_string(); }
+
+#endif // _PADS_BIG_INTEGER_H_
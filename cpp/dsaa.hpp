@@ -5,6 +5,11 @@
 #include <functional>
 #include <memory>
 #include <iostream>
+#include <type_traits>
+#include <vector>
+#include "pool.hpp"
+#include "tree_image.hpp"
+#include "tree_stats.hpp"
 
 namespace dsaa {
 
@@ -39,32 +44,53 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////
 // 1-2-3 Deterministic Skip List
+//
+// Every node of a level is the last one of a gap of 2 to 4 nodes of the level
+// below and holds the same element as that last node. Nodes come from a pool
+// that releases them all at once on destruction.
 
-template<typename Comparable>
-class DSL
+template<typename Comparable, typename S = pads::no_tree_stats>
+class DSL : private S
 {
 public:
   explicit DSL(const Comparable& inf)
     : infinity(inf)
   {
-    bottom = new SkipNode();
-    bottom->right = bottom->down = bottom;
-    tail = new SkipNode(infinity);
-    tail->right = tail;
-    header = new SkipNode(infinity, tail, bottom);
+    init();
+  }
+
+  // Builds the DSL of the sorted range [first, last[ in O(n).
+  template<typename InputIterator>
+  DSL(const Comparable& inf, InputIterator first, InputIterator last)
+    : infinity(inf)
+  {
+    init();
+    build(first, last);
+  }
+
+  ~DSL()
+  {
+    destroy_all(); // the pool releases the memory
+  }
+
+  bool empty() const
+  {
+    return header->down == bottom;
   }
 
   bool contains(const Comparable& x) const
   {
     SkipNode* current = header;
     bottom->element = x;
+    size_t path = 1;
 
-    for (;;) {
+    for (;; ++path) {
       if (x < current->element) {
         current = current->down;
       } else if (current->element < x) {
         current = current->right;
       } else {
+        S::on_operation(pads::op_find, path);
         return current != bottom;
       }
     }
@@ -74,25 +100,166 @@ public:
   {
     SkipNode* current = header;
     bottom->element = x;
+    size_t path = 0;
 
     while (current != bottom) {
       while (current->element < x) {
         current = current->right;
+        ++path;
       }
 
       // if gap size is 3 or at bottom level and must insert, then promote middle element
       if (current->down->right->right->element < current->element) {
-        current->right = new SkipNode(current->element, current->right, current->down->right->right);
+        current->right = new_node(current->element, current->right, current->down->right->right);
         current->element = current->down->right->element;
       } else {
         current = current->down;
+        ++path;
       }
     }
 
     // raise height of DSL if necessary
     if (header->right != tail) {
-      header = new SkipNode(infinity, tail, header);
+      header = new_node(infinity, tail, header);
     }
+    S::on_operation(pads::op_insert, path);
+  }
+
+  void remove(const Comparable& x)
+  {
+    lower();
+    if (empty()) return;
+
+    SkipNode* parent = header;
+    SkipNode* current = header->down;
+    SkipNode* prev = 0;
+    size_t path = 0;
+
+    while (current->down != bottom) {
+      while (current->element < x) {
+        prev = current;
+        current = current->right;
+        ++path;
+      }
+
+      // if the gap below has only 2 nodes, borrow one from or merge with the
+      // gap of a sibling so that it still has 2 nodes after a removal
+      if (!(current->down->right->element < current->element)) {
+        if (current->element < parent->element) {
+          SkipNode* next = current->right;
+          if (next->down->right->element < next->element) {
+            current->element = next->down->element;
+            next->down = next->down->right;
+          } else {
+            current->element = next->element;
+            current->right = next->right;
+            delete_node(next);
+          }
+        } else { // last node of the parent gap, use the left sibling
+          if (prev->down->right->element < prev->element) {
+            SkipNode* y = prev->down;
+            while (y->right->element < prev->element) y = y->right;
+            current->down = y->right;
+            prev->element = y->element;
+          } else {
+            prev->element = current->element;
+            prev->right = current->right;
+            delete_node(current);
+            current = prev;
+          }
+        }
+      }
+
+      parent = current;
+      current = current->down;
+      prev = 0;
+      ++path;
+    }
+
+    while (current->element < x) {
+      prev = current;
+      current = current->right;
+      ++path;
+    }
+    S::on_operation(pads::op_remove, path);
+    if (x < current->element) return; // not found
+
+    const bool last = !(current->element < parent->element);
+    if (prev) {
+      prev->right = current->right;
+      delete_node(current);
+    } else { // first node of its gap, the parent points to it
+      SkipNode* next = current->right;
+      current->element = next->element;
+      current->right = next->right;
+      delete_node(next);
+    }
+
+    // x was the last element of its gap, its copies above become its predecessor
+    if (last) {
+      for (SkipNode* n = header; n != bottom; n = n->down) {
+        while (n->element < x) n = n->right;
+        if (!(x < n->element)) n->element = prev->element;
+      }
+    }
+
+    lower();
+  }
+
+  // Replaces the content with the sorted range [first, last[ in O(n);
+  // elements not greater than their predecessor are skipped.
+  template<typename InputIterator>
+  void build(InputIterator first, InputIterator last)
+  {
+    clear();
+
+    // bottom level
+    SkipNode* level = 0;
+    SkipNode* prev = 0;
+    size_t n = 1;
+    for (; first != last; ++first) {
+      if (prev && !(prev->element < *first)) continue;
+      SkipNode* node = new_node(*first, 0, bottom);
+      if (prev) prev->right = node; else level = node;
+      prev = node;
+      ++n;
+    }
+    if (!prev) return;
+    prev->right = new_node(infinity, tail, bottom);
+
+    // upper levels, with gaps of 3 nodes (2 for the last ones)
+    while (n > 3) {
+      SkipNode* upper = 0;
+      size_t m = 0;
+      prev = 0;
+      for (SkipNode* x = level; n; ++m) {
+        const size_t gap = (n == 4 ? 2 : (n < 3 ? n : 3));
+        SkipNode* node = new_node(Comparable(), tail, x);
+        for (size_t i = 1; i < gap; ++i) x = x->right;
+        node->element = x->element;
+        if (prev) prev->right = node; else upper = node;
+        prev = node;
+        x = x->right;
+        n -= gap;
+      }
+      level = upper;
+      n = m;
+    }
+
+    destroy_node(header);
+    header = new_node(infinity, tail, level);
+  }
+
+  void clear()
+  {
+    destroy_all();
+    pool.clear();
+    init();
+  }
+
+  const S& statistics() const
+  {
+    return *this;
   }
 
 private:
@@ -107,17 +274,75 @@ private:
     {}
   };
 
+  pads::object_pool<SkipNode> pool;
   Comparable infinity;
   SkipNode* header;
   SkipNode* bottom;
   SkipNode* tail;
+
+  DSL(const DSL&);
+  DSL& operator=(const DSL&);
+
+  void init()
+  {
+    bottom = pool.create(SkipNode());
+    bottom->right = bottom->down = bottom;
+    tail = pool.create(SkipNode(infinity));
+    tail->right = tail;
+    header = pool.create(SkipNode(infinity, tail, bottom));
+  }
+
+  SkipNode* new_node(const Comparable& e, SkipNode* r, SkipNode* d)
+  {
+    S::on_allocation();
+    return pool.create(SkipNode(e, r, d));
+  }
+
+  void delete_node(SkipNode* n)
+  {
+    S::on_deallocation();
+    pool.destroy(n);
+  }
+
+  void destroy_node(SkipNode* n)
+  {
+    pool.destroy(n);
+  }
+
+  // lower height of DSL while the header has a single node below
+  void lower()
+  {
+    while (!empty() && header->down->right == tail) {
+      SkipNode* n = header;
+      header = header->down;
+      delete_node(n);
+    }
+  }
+
+  // runs the destructors of all nodes, without releasing them
+  void destroy_all()
+  {
+    if (std::is_trivially_destructible<Comparable>::value) return;
+    for (SkipNode* level = header; level != bottom; ) {
+      SkipNode* down = level->down;
+      for (SkipNode* n = level; n != tail; ) {
+        SkipNode* right = n->right;
+        n->~SkipNode();
+        n = right;
+      }
+      level = down;
+    }
+    tail->~SkipNode();
+    bottom->~SkipNode();
+  }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // Binary Search Tree
 
-template<typename T, typename C = std::less<T>, typename A = std::allocator<T> >
-class BST
+template<typename T, typename C = std::less<T>, typename A = std::allocator<T>,
+         typename S = pads::no_tree_stats>
+class BST : private S
 {
 public:
   BST() : root(0), count(0) {}
@@ -167,14 +392,23 @@ public:
     os << "}\n";
   }
 
+  const S& statistics() const
+  {
+    return *this;
+  }
+
   void insert(const T& t)
   {
-    insert(t, root);
+    size_t path = 0;
+    insert(t, root, path);
+    S::on_operation(pads::op_insert, path);
   }
 
   void remove(const T& t)
   {
-    remove(t, root);
+    size_t path = 0;
+    remove(t, root, path);
+    S::on_operation(pads::op_remove, path);
   }
 
   void clear()
@@ -184,6 +418,55 @@ public:
     count = 0;
   }
 
+  // Writes the values to os as a tree image of keys only (see
+  // tree_image.hpp), in order; T must be trivially copyable.
+  void save(std::ostream& os) const
+  {
+    pads::image_writer<T> out(os, count);
+    std::vector<Node*> stack;
+    for (Node* n = root; n || !stack.empty(); ) {
+      if (n) {
+        stack.push_back(n);
+        n = n->left;
+      } else {
+        n = stack.back();
+        stack.pop_back();
+        out.next().key = n->value;
+        n = n->right;
+      }
+    }
+    out.finish();
+  }
+
+  // Replaces the contents with the image read from is, linked balanced in
+  // O(n). Throws std::runtime_error on a malformed or unsorted image, in
+  // which case the tree is left unchanged.
+  void load(std::istream& is)
+  {
+    pads::image_reader<T> in(is);
+    std::vector<Node*> nodes;
+    nodes.reserve(in.size());
+    try {
+      for (uint64_t i = 0; i < in.size(); ++i) {
+        const T& t = in.next().key;
+        if (i && !comp(nodes.back()->value, t)) throw std::runtime_error("unsorted tree image");
+        S::on_allocation();
+        Node* n = node_alloc.allocate(1);
+        n->value = t;
+        nodes.push_back(n);
+      }
+    } catch (...) {
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        S::on_deallocation();
+        node_alloc.deallocate(nodes[i], 1);
+      }
+      throw;
+    }
+    clear();
+    root = buildBalanced(nodes, 0, nodes.size());
+    count = nodes.size();
+  }
+
 private:
   struct Node
   {
@@ -214,15 +497,18 @@ private:
 
   bool contains(const T& t, Node* n) const
   {
-    while (n) {
+    size_t path = 0;
+    for (; n; ++path) {
       if (comp(t, n->value)) {
         n = n->left;
       } else if (comp(n->value, t)) {
         n = n->right;
       } else {
+        S::on_operation(pads::op_find, path + 1);
         return true;
       }
     }
+    S::on_operation(pads::op_find, path);
     return false;
   }
 
@@ -236,38 +522,42 @@ private:
     }
   }
 
-  void insert(const T& t, Node*& n)
+  void insert(const T& t, Node*& n, size_t& path)
   {
     if (!n) {
+      S::on_allocation();
       n = node_alloc.allocate(1);
       n->left = n->right = 0;
       n->value = t; // or value_alloc.construct(&n->value, t);
       ++count;
     } else if (comp(t, n->value)) {
-      insert(t, n->left);
+      insert(t, n->left, ++path);
     } else if (comp(n->value, t)) {
-      insert(t, n->right);
+      insert(t, n->right, ++path);
     } else {
+      ++path;
       n->value = t;
     }
   }
 
-  void remove(const T& t, Node*& n)
+  void remove(const T& t, Node*& n, size_t& path)
   {
     if (!n) {
       return;
     } else if (comp(t, n->value)) {
-      remove(t, n->left);
+      remove(t, n->left, ++path);
     } else if (comp(n->value, t)) {
-      remove(t, n->right);
+      remove(t, n->right, ++path);
     } else if (n->left && n->right) {
       // find the smallest node of the right subtree,
       // copy its value and remove it
       n->value = findMin(n->right)->value;
-      remove(n->value, n->right);
+      remove(n->value, n->right, ++path);
     } else {
+      ++path;
       Node* p = n;
       n = (n->left ? n->left : n->right);
+      S::on_deallocation();
       node_alloc.deallocate(p, 1);
       --count;
     }
@@ -278,14 +568,27 @@ private:
     if (n) {
       clear(n->left);
       clear(n->right);
+      S::on_deallocation();
       node_alloc.deallocate(n, 1);
       --count;
     }
   }
 
+  // Links the ordered nodes [first, last[ into a balanced subtree.
+  Node* buildBalanced(const std::vector<Node*>& nodes, size_t first, size_t last)
+  {
+    if (first == last) return 0;
+    const size_t mid = first + (last - first) / 2;
+    Node* n = nodes[mid];
+    n->left = buildBalanced(nodes, first, mid);
+    n->right = buildBalanced(nodes, mid + 1, last);
+    return n;
+  }
+
   void deepCopy(Node*& n, const Node* rhs)
   {
     if (rhs) {
+      S::on_allocation();
       n = node_alloc.allocate(1);
       n->value = rhs->value; // or value_alloc.construct(&n->value, rhs->value);
       ++count;
@@ -300,8 +603,9 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 // Top-Down Splay Tree
 
-template<typename T, typename C = std::less<T>, typename A = std::allocator<T> >
-class splay_tree
+template<typename T, typename C = std::less<T>, typename A = std::allocator<T>,
+         typename S = pads::no_tree_stats>
+class splay_tree : private S
 {
 public:
   splay_tree()
@@ -323,7 +627,7 @@ public:
   {
     if (this != &rhs) {
       clear();
-      root = clone(rhs.root);
+      root = clone(rhs.root, rhs.null_node);
     }
     return *this;
   }
@@ -345,7 +649,7 @@ public:
     if (empty()) throw std::underflow_error("empty tree");
     node* n = root;
     while (!is_null(n->left)) n = n->left;
-    splay(n->value, root);
+    S::on_operation(pads::op_find, splay(n->value, root));
     return n->value;
   }
 
@@ -354,30 +658,34 @@ public:
     if (empty()) throw std::underflow_error("empty tree");
     node* n = root;
     while (!is_null(n->right)) n = n->right;
-    splay(n->value, root);
+    S::on_operation(pads::op_find, splay(n->value, root));
     return n->value;
   }
 
   bool contains(const T& t)
   {
     if (empty()) return false;
-    splay(t, root);
+    S::on_operation(pads::op_find, splay(t, root));
     return root->value == t;
   }
 
   void insert(const T& t)
   {
     if (root == null_node) {
+      S::on_operation(pads::op_insert, 0);
+      S::on_allocation();
       root = node_alloc.allocate(1);
       root->reset(t, null_node, null_node);
     } else {
-      splay(t, root);
+      S::on_operation(pads::op_insert, splay(t, root));
       if (comp(t, root->value)) {
+        S::on_allocation();
         node* n = node_alloc.allocate(1);
         n->reset(t, root->left, root);
         root->left = null_node;
         root = n;
       } else if (comp(root->value, t)) {
+        S::on_allocation();
         node* n = node_alloc.allocate(1);
         n->reset(t, root, root->right);
         root->right = null_node;
@@ -391,17 +699,22 @@ public:
 
   void remove(const T& t)
   {
-    splay(t, root);
-    if (root->value != t) return;
+    size_t path = splay(t, root);
+    if (root->value != t) {
+      S::on_operation(pads::op_remove, path);
+      return;
+    }
 
     node* new_root;
     if (is_null(root->left)) {
       new_root = root->right;
     } else {
       new_root = root->left;
-      splay(t, new_root);
+      path += splay(t, new_root);
       new_root->right = root->right;
     }
+    S::on_operation(pads::op_remove, path);
+    S::on_deallocation();
     node_alloc.deallocate(root, 1);
     root = new_root;
   }
@@ -421,6 +734,11 @@ public:
     os << "}\n";
   }
 
+  const S& statistics() const
+  {
+    return *this;
+  }
+
 private:
   struct node
   {
@@ -453,19 +771,18 @@ private:
     }
   }
 
-  node* clone(node* n) const
+  node* clone(const node* n, const node* rhs_null_node)
   {
-    if (n == n->left) { // cannot test against null_node...
-      return null_node;
-    } else {
-      node* n = node_alloc.allocate(1);
-      n->reset(n->value, clone(n->left), clone(n->right));
-      return n;
-    }
+    if (n == rhs_null_node) return null_node;
+    S::on_allocation();
+    node* c = node_alloc.allocate(1);
+    c->reset(n->value, clone(n->left, rhs_null_node), clone(n->right, rhs_null_node));
+    return c;
   }
 
   void left_rotation(node*& n)
   {
+    S::on_rotation();
     node* k = n->left;
     n->left = k->right;
     k->right = n;
@@ -474,14 +791,17 @@ private:
 
   void right_rotation(node*& n)
   {
+    S::on_rotation();
     node* k = n->right;
     n->right = k->left;
     k->left = n;
     n = k;
   }
 
-  void splay(const T& t, node*& n)
+  // Returns the length of the splayed path.
+  size_t splay(const T& t, node*& n)
   {
+    size_t path = 1;
     node* leftTreeMax;
     node* rightTreeMin;
     node header;
@@ -493,14 +813,20 @@ private:
 
     for (;;) {
       if (comp(t, n->value)) {
-        if (comp(t, n->left->value)) left_rotation(n);
+        if (comp(t, n->left->value)) {
+          left_rotation(n);
+          ++path;
+        }
         if (n->left == null_node) break;
         // link right
         rightTreeMin->left = n;
         rightTreeMin = n;
         n = n->left;
       } else if (comp(n->value, t)) {
-        if (comp(n->right->value, t)) right_rotation(n);
+        if (comp(n->right->value, t)) {
+          right_rotation(n);
+          ++path;
+        }
         if (n->right == null_node) break;
         // link left
         leftTreeMax->right = n;
@@ -509,21 +835,23 @@ private:
       } else {
         break;
       }
+      ++path;
     }
 
     leftTreeMax->right = n->left;
     rightTreeMin->left = n->right;
     n->left = header.right;
     n->right = header.left;
+    return path;
   }
 };
 
 } // namespace dsaa
 
-template<typename T>
-std::ostream& operator<<(std::ostream& os, dsaa::BST<T>& bst) { bst.print(os); return os; }
+template<typename T, typename C, typename A, typename S>
+std::ostream& operator<<(std::ostream& os, dsaa::BST<T, C, A, S>& bst) { bst.print(os); return os; }
 
-template<typename T>
-std::ostream& operator<<(std::ostream& os, dsaa::splay_tree<T>& st) { st.print(os); return os; }
+template<typename T, typename C, typename A, typename S>
+std::ostream& operator<<(std::ostream& os, dsaa::splay_tree<T, C, A, S>& st) { st.print(os); return os; }
 
 #endif // _DSAA_H_
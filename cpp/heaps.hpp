@@ -0,0 +1,416 @@
+#ifndef _HEAPS_HPP_
+#define _HEAPS_HPP_
+
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include "pool.hpp"
+
+namespace pads {
+
+////////////////////////////////////////////////////////////////////////////////
+// Pairing Heap
+//
+// Min-heap (for C = std::less<K>) of (key, value) pairs with O(1) push, meld
+// and decrease_key, and O(log n) amortized pop. push() returns a handle that
+// stays valid until its pair is popped or erased. Nodes come from a pool
+// that releases them all at once on destruction.
+
+template<typename K, typename T, typename C = std::less<K> >
+class pairing_heap
+{
+  struct node
+  {
+    K key;
+    T value;
+    node* child;
+    node* sibling;
+    node* prev; // parent of a first child, left sibling otherwise
+
+    node(const K& k, const T& t)
+      : key(k), value(t), child(0), sibling(0), prev(0)
+    {}
+  };
+
+public:
+  typedef node* handle;
+
+  pairing_heap()
+    : root(0), count(0)
+  {}
+
+  ~pairing_heap()
+  {
+    destroy_all(); // the pool releases the memory
+  }
+
+  bool empty() const
+  {
+    return !root;
+  }
+
+  size_t size() const
+  {
+    return count;
+  }
+
+  const K& top_key() const
+  {
+    if (empty()) throw std::underflow_error("empty heap");
+    return root->key;
+  }
+
+  const T& top() const
+  {
+    if (empty()) throw std::underflow_error("empty heap");
+    return root->value;
+  }
+
+  static const K& key(handle h) { return h->key; }
+  static T& value(handle h) { return h->value; }
+
+  handle push(const K& k, const T& t)
+  {
+    node* n = pool.create(node(k, t));
+    root = (root ? link(root, n) : n);
+    ++count;
+    return n;
+  }
+
+  void pop()
+  {
+    if (empty()) throw std::underflow_error("empty heap");
+    node* old = root;
+    root = merge_pairs(root->child);
+    pool.destroy(old);
+    --count;
+  }
+
+  // Lowers the key of h to k, which must not compare greater than its key.
+  void decrease_key(handle h, const K& k)
+  {
+    h->key = k;
+    if (h == root) return;
+    detach(h);
+    root = link(root, h);
+  }
+
+  // Removes the pair of h, in O(log n) amortized.
+  void erase(handle h)
+  {
+    if (h == root) {
+      pop();
+      return;
+    }
+    detach(h);
+    node* children = merge_pairs(h->child);
+    if (children) root = link(root, children);
+    pool.destroy(h);
+    --count;
+  }
+
+  // Moves the pairs of other into this heap in O(1) plus the free slots of
+  // its pool; the handles of other remain valid in this heap.
+  void meld(pairing_heap& other)
+  {
+    if (&other == this || !other.root) return;
+    pool.splice(other.pool);
+    root = (root ? link(root, other.root) : other.root);
+    count += other.count;
+    other.root = 0;
+    other.count = 0;
+  }
+
+  void clear()
+  {
+    destroy_all();
+    pool.clear();
+    root = 0;
+    count = 0;
+  }
+
+private:
+  object_pool<node> pool;
+  node* root;
+  size_t count;
+  C comp;
+
+  pairing_heap(const pairing_heap&);
+  pairing_heap& operator=(const pairing_heap&);
+
+  // Makes the root with the larger key the first child of the other one,
+  // and returns the new root; a and b are roots.
+  node* link(node* a, node* b)
+  {
+    if (comp(b->key, a->key)) std::swap(a, b);
+    b->prev = a;
+    b->sibling = a->child;
+    if (a->child) a->child->prev = b;
+    a->child = b;
+    a->sibling = a->prev = 0;
+    return a;
+  }
+
+  // Cuts the subtree of the non-root n from its parent.
+  void detach(node* n)
+  {
+    if (n->prev->child == n) {
+      n->prev->child = n->sibling;
+    } else {
+      n->prev->sibling = n->sibling;
+    }
+    if (n->sibling) n->sibling->prev = n->prev;
+    n->sibling = n->prev = 0;
+  }
+
+  // Two-pass pairing of a sibling list: links the siblings by pairs from
+  // left to right, then links the pairs from right to left.
+  node* merge_pairs(node* first)
+  {
+    if (!first) return 0;
+    node* pairs = 0; // the pairs, chained through prev in reverse order
+    while (first) {
+      node* a = first;
+      node* b = a->sibling;
+      if (!b) {
+        a->prev = pairs;
+        pairs = a;
+        break;
+      }
+      first = b->sibling;
+      a->sibling = b->sibling = 0;
+      node* p = link(a, b);
+      p->prev = pairs;
+      pairs = p;
+    }
+    node* r = pairs;
+    for (node* p = r->prev; p; ) {
+      node* prev = p->prev;
+      r = link(p, r);
+      p = prev;
+    }
+    r->sibling = r->prev = 0;
+    return r;
+  }
+
+  // runs the destructors of all nodes, without releasing them
+  void destroy_all()
+  {
+    if (std::is_trivially_destructible<node>::value || !root) return;
+    std::vector<node*> stack(1, root);
+    while (!stack.empty()) {
+      node* n = stack.back();
+      stack.pop_back();
+      for (node* c = n->child; c; c = c->sibling) stack.push_back(c);
+      n->~node();
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Radix Heap
+//
+// Monotone min-heap of unsigned integer keys: a pushed key must not be lower
+// than the last popped one, as with the distances of Dijkstra's algorithm or
+// the deadlines of a timer queue. Bucket 0 holds the keys equal to the last
+// popped one, bucket i the keys that first differ from it at bit i - 1; when
+// bucket 0 is empty, the lowest non-empty bucket is redistributed around its
+// minimum. Every pair moves at most bits times, so that pop() costs
+// O(bits) amortized and push() O(1).
+
+template<typename K, typename T>
+class radix_heap
+{
+  static_assert(std::is_unsigned<K>::value, "radix_heap needs unsigned keys");
+  enum { bits = 8 * sizeof(K) };
+
+public:
+  radix_heap()
+    : last(0), count(0)
+  {}
+
+  bool empty() const
+  {
+    return !count;
+  }
+
+  size_t size() const
+  {
+    return count;
+  }
+
+  // The last popped key, which bounds the keys that can be pushed.
+  K last_key() const
+  {
+    return last;
+  }
+
+  void push(const K& k, const T& t)
+  {
+    if (k < last) throw std::domain_error("radix_heap: key below the last popped one");
+    buckets[bucket(k)].push_back(std::make_pair(k, t));
+    ++count;
+  }
+
+  // A pair with the lowest key. Not const: the lowest bucket may have to be
+  // redistributed first.
+  const K& top_key()
+  {
+    prepare();
+    return buckets[0].back().first;
+  }
+
+  const T& top()
+  {
+    prepare();
+    return buckets[0].back().second;
+  }
+
+  void pop()
+  {
+    prepare();
+    buckets[0].pop_back();
+    --count;
+  }
+
+  void clear()
+  {
+    for (int i = 0; i <= bits; ++i) buckets[i].clear();
+    last = 0;
+    count = 0;
+  }
+
+private:
+  std::vector<std::pair<K, T> > buckets[bits + 1];
+  K last;
+  size_t count;
+
+  int bucket(const K& k) const
+  {
+    return (k == last ? 0 : bits - clz(k ^ last));
+  }
+
+  static int clz(unsigned long long x)
+  {
+    return __builtin_clzll(x) - (64 - bits);
+  }
+
+  // Fills bucket 0 with the pairs of the lowest key.
+  void prepare()
+  {
+    if (!buckets[0].empty()) return;
+    if (!count) throw std::underflow_error("empty heap");
+    int i = 1;
+    while (buckets[i].empty()) ++i;
+    std::vector<std::pair<K, T> >& b = buckets[i];
+    K m = b[0].first;
+    for (size_t j = 1; j < b.size(); ++j) {
+      if (b[j].first < m) m = b[j].first;
+    }
+    last = m;
+    // every key of bucket i now falls into a lower bucket
+    for (size_t j = 0; j < b.size(); ++j) buckets[bucket(b[j].first)].push_back(b[j]);
+    b.clear();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// D-ary Heap
+//
+// Implicit min-heap in an array, with D children per node: a larger D makes
+// the tree shallower, so pushes move less, while the D children compared by
+// a pop sit in one or two cache lines. D = 4 suits keys of 8 to 16 bytes.
+
+template<typename T, int D = 4, typename C = std::less<T> >
+class d_ary_heap
+{
+  static_assert(D >= 2, "d_ary_heap needs at least 2 children per node");
+
+public:
+  bool empty() const
+  {
+    return heap.empty();
+  }
+
+  size_t size() const
+  {
+    return heap.size();
+  }
+
+  const T& top() const
+  {
+    if (empty()) throw std::underflow_error("empty heap");
+    return heap.front();
+  }
+
+  void push(const T& t)
+  {
+    heap.push_back(t);
+    sift_up(heap.size() - 1);
+  }
+
+  void pop()
+  {
+    if (empty()) throw std::underflow_error("empty heap");
+    if (heap.size() > 1) {
+      T t = heap.back();
+      heap.pop_back();
+      sift_down(t);
+    } else {
+      heap.pop_back();
+    }
+  }
+
+  void reserve(size_t n)
+  {
+    heap.reserve(n);
+  }
+
+  void clear()
+  {
+    heap.clear();
+  }
+
+private:
+  std::vector<T> heap;
+  C comp;
+
+  void sift_up(size_t i)
+  {
+    T t = heap[i];
+    while (i > 0) {
+      const size_t parent = (i - 1) / D;
+      if (!comp(t, heap[parent])) break;
+      heap[i] = heap[parent];
+      i = parent;
+    }
+    heap[i] = t;
+  }
+
+  // Moves t down from the root into the hole left by the former top.
+  void sift_down(const T& t)
+  {
+    const size_t n = heap.size();
+    size_t i = 0;
+    for (;;) {
+      const size_t first = D * i + 1;
+      if (first >= n) break;
+      const size_t last = (first + D < n ? first + D : n);
+      size_t m = first;
+      for (size_t c = first + 1; c < last; ++c) {
+        if (comp(heap[c], heap[m])) m = c;
+      }
+      if (!comp(heap[m], t)) break;
+      heap[i] = heap[m];
+      i = m;
+    }
+    heap[i] = t;
+  }
+};
+
+} // namespace pads
+
+#endif // _HEAPS_HPP_
@@ -1,61 +1,312 @@
+#ifndef _PADS_INTEGER_H_
+#define _PADS_INTEGER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "modular.hpp"
+
 namespace pads {
 namespace math {
 
 typedef long long integer;
 
-inline bool odd(const integer n) { return (n & 0x1) != 0; }
-inline bool even(const integer n) { return (n & 0x1) == 0; }
-inline integer abs(const integer n) { return (n < 0 ? -n : n); }
+constexpr bool odd(const integer n) { return (n & 0x1) != 0; }
+constexpr bool even(const integer n) { return (n & 0x1) == 0; }
+constexpr integer abs(const integer n) { return (n < 0 ? -n : n); }
+
+// Returns (a * b) mod n without overflow, for 0 <= a, b < n.
+constexpr integer mulmod(integer a, integer b, integer n)
+{
+  return (integer) ((unsigned __int128) a * b % n);
+}
+
+/// GCD ///
+
+// Binary (Stein's) GCD: the powers of two are stripped with one ctz each.
+constexpr integer gcd(integer x, integer y)
+{
+  unsigned long long a = abs(x);
+  unsigned long long b = abs(y);
+  if (!a) return b;
+  if (!b) return a;
+  const int shift = __builtin_ctzll(a | b);
+  a >>= __builtin_ctzll(a);
+  do {
+    b >>= __builtin_ctzll(b);
+    if (a > b) {
+      const unsigned long long t = a;
+      a = b;
+      b = t;
+    }
+    b -= a;
+  } while (b);
+  return a << shift;
+}
+
+constexpr integer lcm(integer x, integer y)
+{
+  return (x && y ? abs(x / gcd(x, y) * y) : 0);
+}
+
+// Extended Euclid: returns g = gcd(a, b) and sets x, y such that a*x + b*y = g.
+constexpr integer ext_gcd(integer a, integer b, integer& x, integer& y)
+{
+  integer x0 = 1, y0 = 0, x1 = 0, y1 = 1;
+  while (b) {
+    const integer q = a / b;
+    integer t = a - q * b; a = b; b = t;
+    t = x0 - q * x1; x0 = x1; x1 = t;
+    t = y0 - q * y1; y0 = y1; y1 = t;
+  }
+  if (a < 0) {
+    a = -a; x0 = -x0; y0 = -y0;
+  }
+  x = x0;
+  y = y0;
+  return a;
+}
+
+// Returns the inverse of a modulo n in [0, n[, or 0 if a is not invertible.
+constexpr integer modinv(integer a, integer n)
+{
+  integer x = 0, y = 0;
+  a %= n;
+  if (a < 0) a += n;
+  if (ext_gcd(a, n, x, y) != 1) return 0;
+  return (x < 0 ? x + n : x);
+}
+
+/// Batch Functions ///
 
-integer gcd(integer x, integer y)
+// out[i] = gcd(first1[i], first2[i]) for i in [0, last1 - first1[.
+// Four GCDs are interleaved so that their dependency chains overlap.
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+OutputIterator batch_gcd(InputIterator1 first1, InputIterator1 last1, InputIterator2 first2, OutputIterator out)
 {
-  integer g = 1;
-  while (even(x) && even(y)) {
-    x >>= 1;
-    y >>= 1;
-    g <<= 1;
+  enum { L = 4 };
+  unsigned long long a[L], b[L];
+  int shift[L];
+
+  while (first1 != last1) {
+    int n = 0;
+    for (; n < L && first1 != last1; ++n, ++first1, ++first2) {
+      a[n] = abs(*first1);
+      b[n] = abs(*first2);
+      if (!a[n] || !b[n]) {
+        a[n] |= b[n];
+        b[n] = shift[n] = 0;
+      } else {
+        shift[n] = __builtin_ctzll(a[n] | b[n]);
+        a[n] >>= __builtin_ctzll(a[n]);
+      }
+    }
+
+    for (bool active = true; active; ) {
+      active = false;
+      for (int i = 0; i < n; ++i) {
+        if (!b[i]) continue;
+        b[i] >>= __builtin_ctzll(b[i]);
+        const unsigned long long lo = (a[i] < b[i] ? a[i] : b[i]);
+        b[i] = (a[i] < b[i] ? b[i] : a[i]) - lo;
+        a[i] = lo;
+        active |= (b[i] != 0);
+      }
+    }
+
+    for (int i = 0; i < n; ++i) {
+      *out++ = (integer) (a[i] << shift[i]);
+    }
+  }
+  return out;
+}
+
+// Montgomery's trick: inverts [first, last[ modulo n with a single modinv
+// and 3 multiplications per element; out[i] = 0 where first[i] is 0 mod n.
+// Falls back to one modinv per element if some element is not invertible.
+template<typename RandomAccessIterator, typename OutputIterator>
+OutputIterator batch_modinv(RandomAccessIterator first, RandomAccessIterator last, integer n, OutputIterator out)
+{
+  const size_t size = last - first;
+  std::vector<integer> a(size), prefix(size);
+  integer p = 1;
+  for (size_t i = 0; i < size; ++i) {
+    a[i] = first[i] % n;
+    if (a[i] < 0) a[i] += n;
+    if (a[i]) p = mulmod(p, a[i], n);
+    prefix[i] = p;
+  }
+
+  integer inv = modinv(p, n);
+  if (!inv && size) {
+    for (size_t i = 0; i < size; ++i) *out++ = (a[i] ? modinv(a[i], n) : 0);
+    return out;
   }
-  while (x) {
-    while (even(x)) x >>= 1;
-    while (even(y)) y >>= 1;
-    const integer t = abs(x - y) / 2;
-    if (x >= y) {
-      x = t;
+
+  for (size_t i = size; i--; ) {
+    if (a[i]) {
+      prefix[i] = mulmod(inv, (i ? prefix[i-1] : 1), n);
+      inv = mulmod(inv, a[i], n);
     } else {
-      y = t;
+      prefix[i] = 0;
     }
   }
-  return g * y;
+  return std::copy(prefix.begin(), prefix.end(), out);
 }
 
-integer phi(integer n)
+/// Class Types ///
+
+// The functions above are constexpr and specific to the builtin integers.
+// These templates accept class types with the arithmetic operators, such as
+// big_integer; gcd, abs and modexp are found by argument-dependent lookup.
+
+template<typename I>
+using if_class = typename std::enable_if<std::is_class<I>::value, I>::type;
+
+template<typename I>
+if_class<I> lcm(const I& x, const I& y)
 {
-  integer count = 1;
-  if (even(n)) {
-    for (integer i = 3; i < n; i+=2) {
-      if (gcd(n, i) == 1) ++count;
+  if (x == I(0) || y == I(0)) return I(0);
+  return abs(x / gcd(x, y) * y);
+}
+
+template<typename I>
+if_class<I> ext_gcd(I a, I b, I& x, I& y)
+{
+  I x0 = 1, y0 = 0, x1 = 0, y1 = 1;
+  while (b != I(0)) {
+    const I q = a / b;
+    I t = a - q * b; a = b; b = t;
+    t = x0 - q * x1; x0 = x1; x1 = t;
+    t = y0 - q * y1; y0 = y1; y1 = t;
+  }
+  if (a < I(0)) {
+    a = -a; x0 = -x0; y0 = -y0;
+  }
+  x = x0;
+  y = y0;
+  return a;
+}
+
+template<typename I>
+if_class<I> modinv(I a, const I& n)
+{
+  I x, y;
+  a = a % n;
+  if (a < I(0)) a = a + n;
+  if (ext_gcd(a, n, x, y) != I(1)) return I(0);
+  return (x < I(0) ? x + n : x);
+}
+
+// Returns a^b mod n for b >= 0: square and multiply in Montgomery form for an
+// odd n, with Barrett reductions for an even one.
+constexpr integer modexp(integer a, integer b, integer n)
+{
+  if (b == 0) return 1;
+  a %= n;
+  if (a < 0) a += n;
+  if (odd(n)) {
+    const montgomery m(n);
+    return (integer) m.from(m.pow(m.to(a), b));
+  }
+  const barrett m(n);
+  unsigned long long x = 1, y = a;
+  for (;;) {
+    if (odd(b)) x = m.mul(x, y);
+    if (!(b >>= 1)) return (integer) x;
+    y = m.mul(y, y);
+  }
+}
+
+/// Euler's Totient ///
+
+// Strong probable prime test to base a of the odd modulus of m.
+constexpr bool strong_probable_prime(const montgomery& m, integer a)
+{
+  const unsigned long long minus_one = m.n - m.r;
+  const int s = __builtin_ctzll(m.n - 1);
+  unsigned long long x = m.pow(m.to(a), (m.n - 1) >> s);
+  if (x == m.r || x == minus_one) return true;
+  for (int i = 1; i < s; ++i) {
+    x = m.mul(x, x);
+    if (x == minus_one) return true;
+  }
+  return false;
+}
+
+// Returns a nontrivial factor of the odd composite n (Pollard's rho with
+// Brent's cycle detection, the gcds batched over 128 steps).
+inline integer pollard_rho(integer n)
+{
+  const montgomery m(n);
+  for (unsigned long long c = m.r; ; c = m.add(c, m.r)) {
+    unsigned long long x = 0, y = m.to(2), ys = y, q = m.r;
+    integer g = 1;
+    for (integer r = 1; g == 1; r *= 2) {
+      x = y;
+      for (integer i = 0; i < r; ++i) y = m.add(m.mul(y, y), c);
+      for (integer k = 0; k < r && g == 1; k += 128) {
+        ys = y;
+        for (integer i = 0; i < 128 && i < r - k; ++i) {
+          y = m.add(m.mul(y, y), c);
+          q = m.mul(q, (x > y ? x - y : y - x));
+        }
+        g = gcd((integer) q, n);
+      }
     }
-  } else {
-    for (integer i = 2; i < n; ++i) {
-      if (gcd(n, i) == 1) ++count;
+    if (g == n) { // the batch overshot: step again one at a time
+      do {
+        ys = m.add(m.mul(ys, ys), c);
+        g = gcd((integer) (x > ys ? x - ys : ys - x), n);
+      } while (g == 1);
     }
+    if (g != n) return g;
   }
-  return count;
 }
 
-integer modexp(integer a, integer b, integer n)
+// phi(n) from the factorization of n: trial division up to 2^10, then
+// Pollard's rho on the cofactor, whose factors are tested with the 7 bases
+// of Sinclair that are deterministic below 2^64.
+inline integer phi(integer n)
 {
-  if (b == 0) return 1;
-  if (b == 1) return a % n;
-  if (odd(b)) {
-    const integer x = a % n;
-    return (x * modexp(a, b-1, n)) % n;
-  } else {
-    integer x = a % n;
-    x = (x * x) % n;
-    return (modexp(x, b/2, n) % n);
+  if (n < 1) return 0;
+  integer result = n;
+  for (integer d = 2; d < 1024 && d * d <= n; d += 1 + (d > 2)) {
+    if (n % d) continue;
+    result = result / d * (d - 1);
+    do n /= d; while (n % d == 0);
+  }
+  if (n == 1) return result;
+
+  std::vector<integer> pending(1, n), factors;
+  while (!pending.empty()) {
+    const integer f = pending.back();
+    pending.pop_back();
+    bool prime = (f < 1024 * 1024);
+    if (!prime) {
+      static const integer bases[7] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+      const montgomery m(f);
+      prime = true;
+      for (int i = 0; i < 7 && prime; ++i) {
+        prime = (bases[i] % f == 0 || strong_probable_prime(m, bases[i]));
+      }
+    }
+    if (prime) {
+      factors.push_back(f);
+    } else {
+      const integer d = pollard_rho(f);
+      pending.push_back(d);
+      pending.push_back(f / d);
+    }
   }
+  std::sort(factors.begin(), factors.end());
+  factors.erase(std::unique(factors.begin(), factors.end()), factors.end());
+  for (size_t i = 0; i < factors.size(); ++i) result = result / factors[i] * (factors[i] - 1);
+  return result;
 }
 
 } // namespace math
 } // namespace pads
+
+#endif // _PADS_INTEGER_H_
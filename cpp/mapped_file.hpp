@@ -0,0 +1,69 @@
+#ifndef _MAPPED_FILE_HPP_
+#define _MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pads {
+
+////////////////////////////////////////////////////////////////////////////////
+// Read-Only Memory-Mapped File
+//
+// The whole file is mapped shared and read-only, so every process mapping
+// the same file uses the same page-cache copy. Throws std::runtime_error if
+// the file cannot be opened or mapped.
+
+class mapped_file
+{
+public:
+  explicit mapped_file(const std::string& path)
+    : address(0), length(0)
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+      ::close(fd);
+      throw std::runtime_error("cannot stat " + path);
+    }
+    length = st.st_size;
+    if (length) {
+      address = ::mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+      if (address == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("cannot map " + path);
+      }
+    }
+    ::close(fd);
+  }
+
+  ~mapped_file()
+  {
+    if (address) ::munmap(address, length);
+  }
+
+  const char* data() const { return static_cast<const char*>(address); }
+  size_t size() const { return length; }
+
+  // Hints the kernel about the access pattern, e.g. MADV_RANDOM or MADV_WILLNEED.
+  void advise(int advice) const
+  {
+    if (address) ::madvise(address, length, advice);
+  }
+
+private:
+  void* address;
+  size_t length;
+
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
+};
+
+} // namespace pads
+
+#endif // _MAPPED_FILE_HPP_
@@ -0,0 +1,266 @@
+#ifndef _PADS_MODULAR_H_
+#define _PADS_MODULAR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace pads {
+namespace math {
+
+typedef long long integer;
+
+////////////////////////////////////////////////////////////////////////////////
+// Fixed-Modulus Reduction
+//
+// Both contexts precompute constants for one modulus n < 2^63 so that the
+// products modulo n need multiplications only, no hardware division.
+
+// Montgomery form, for odd n: x is represented by x * 2^64 mod n.
+struct montgomery
+{
+  unsigned long long n, inv, r, r2; // inv = n^-1 mod 2^64, r = 2^64 mod n
+
+  constexpr montgomery()
+    : n(1), inv(1), r(0), r2(0)
+  {}
+
+  constexpr explicit montgomery(unsigned long long m)
+    : n(m), inv(m), r((0 - m) % m), r2(0)
+  {
+    for (int i = 0; i < 5; ++i) inv *= 2 - m * inv; // Newton: 5, 10, 20, 40, 80 bits
+    r2 = (unsigned __int128) r * r % m;
+  }
+
+  constexpr unsigned long long reduce(unsigned __int128 t) const
+  {
+    const unsigned long long q = (unsigned long long) t * inv;
+    const unsigned long long h = (unsigned __int128) q * n >> 64;
+    const unsigned long long x = (unsigned long long) (t >> 64);
+    return (x < h ? x + n - h : x - h);
+  }
+
+  constexpr unsigned long long mul(unsigned long long a, unsigned long long b) const { return reduce((unsigned __int128) a * b); }
+  constexpr unsigned long long add(unsigned long long a, unsigned long long b) const { return (a >= n - b ? a - (n - b) : a + b); }
+  constexpr unsigned long long sub(unsigned long long a, unsigned long long b) const { return (a < b ? a + (n - b) : a - b); }
+  constexpr unsigned long long to(unsigned long long a) const { return mul(a % n, r2); }
+  constexpr unsigned long long from(unsigned long long a) const { return reduce(a); }
+
+  constexpr unsigned long long pow(unsigned long long a, unsigned long long e) const // a, result in Montgomery form
+  {
+    unsigned long long x = r;
+    for (; e; e >>= 1) {
+      if (e & 1) x = mul(x, a);
+      a = mul(a, a);
+    }
+    return x;
+  }
+};
+
+// Barrett reduction, for any n >= 1: with k the bit length of n and
+// mu = floor((2^2k - 1) / n), q = ((t >> (k-1)) * mu) >> (k+1) is at most
+// 3 below t / n, for t < n^2.
+struct barrett
+{
+  unsigned long long n, mu;
+  int k;
+
+  constexpr explicit barrett(unsigned long long m)
+    : n(m), mu(0), k(64 - __builtin_clzll(m))
+  {
+    mu = (unsigned long long) ((((unsigned __int128) 1 << (2 * k)) - 1) / m);
+  }
+
+  constexpr unsigned long long reduce(unsigned __int128 t) const
+  {
+    const unsigned long long q = (unsigned long long) (((t >> (k - 1)) * mu) >> (k + 1));
+    unsigned __int128 x = t - (unsigned __int128) q * n;
+    while (x >= n) x -= n;
+    return (unsigned long long) x;
+  }
+
+  constexpr unsigned long long mul(unsigned long long a, unsigned long long b) const { return reduce((unsigned __int128) a * b); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Residue Types
+//
+// modular<Tag> has a runtime modulus, set per thread and per tag with
+// set_modulus(); static_modular<M> has its constants computed at compile
+// time. Both are 8 bytes, store their value in Montgomery form, and need an
+// odd modulus.
+
+template<typename Tag = void>
+class modular
+{
+public:
+  static void set_modulus(integer n)
+  {
+    if (n < 1 || !(n & 1)) throw std::domain_error("modular: the modulus must be odd");
+    context() = montgomery(n);
+  }
+
+  static integer modulus() { return context().n; }
+
+  modular() : x(0) {}
+  modular(integer a) : x(context().to(a < 0 ? a % modulus() + modulus() : a)) {}
+
+  integer value() const { return context().from(x); }
+
+  modular operator-() const { return raw(context().sub(0, x)); }
+  modular& operator+=(const modular& rhs) { x = context().add(x, rhs.x); return *this; }
+  modular& operator-=(const modular& rhs) { x = context().sub(x, rhs.x); return *this; }
+  modular& operator*=(const modular& rhs) { x = context().mul(x, rhs.x); return *this; }
+
+  friend modular operator+(modular a, const modular& b) { return a += b; }
+  friend modular operator-(modular a, const modular& b) { return a -= b; }
+  friend modular operator*(modular a, const modular& b) { return a *= b; }
+  friend bool operator==(const modular& a, const modular& b) { return a.x == b.x; }
+  friend bool operator!=(const modular& a, const modular& b) { return a.x != b.x; }
+
+  friend modular pow(const modular& a, unsigned long long e) { return raw(context().pow(a.x, e)); }
+
+private:
+  unsigned long long x;
+
+  static modular raw(unsigned long long v) { modular m; m.x = v; return m; }
+
+  static montgomery& context()
+  {
+    static thread_local montgomery c;
+    return c;
+  }
+};
+
+///
+
+template<integer M>
+class static_modular
+{
+  static_assert(M > 0 && (M & 1), "static_modular: the modulus must be odd");
+  static constexpr montgomery context = montgomery(M);
+
+public:
+  static constexpr integer modulus() { return M; }
+
+  constexpr static_modular() : x(0) {}
+  constexpr static_modular(integer a) : x(context.to(a < 0 ? a % M + M : a)) {}
+
+  constexpr integer value() const { return context.from(x); }
+
+  constexpr static_modular operator-() const { return raw(context.sub(0, x)); }
+  constexpr static_modular& operator+=(const static_modular& rhs) { x = context.add(x, rhs.x); return *this; }
+  constexpr static_modular& operator-=(const static_modular& rhs) { x = context.sub(x, rhs.x); return *this; }
+  constexpr static_modular& operator*=(const static_modular& rhs) { x = context.mul(x, rhs.x); return *this; }
+
+  friend constexpr static_modular operator+(static_modular a, const static_modular& b) { return a += b; }
+  friend constexpr static_modular operator-(static_modular a, const static_modular& b) { return a -= b; }
+  friend constexpr static_modular operator*(static_modular a, const static_modular& b) { return a *= b; }
+  friend constexpr bool operator==(const static_modular& a, const static_modular& b) { return a.x == b.x; }
+  friend constexpr bool operator!=(const static_modular& a, const static_modular& b) { return a.x != b.x; }
+
+  friend constexpr static_modular pow(const static_modular& a, unsigned long long e) { return raw(context.pow(a.x, e)); }
+
+private:
+  unsigned long long x;
+
+  static constexpr static_modular raw(unsigned long long v) { static_modular m; m.x = v; return m; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch Residues
+//
+// Montgomery arithmetic on arrays of 32-bit residues modulo an odd n < 2^31,
+// with 2^32 as Montgomery radix. With AVX2 the products are computed 8 lanes
+// at a time (two 4 x 32-bit multiplies for the even and odd lanes), and
+// without AVX2 by the equivalent scalar loop.
+
+class modular_batch
+{
+public:
+  explicit modular_batch(uint32_t m)
+    : n(m), inv(m), r2(0)
+  {
+    if (m < 3 || m >= (1u << 31) || !(m & 1)) throw std::domain_error("modular_batch: the modulus must be odd and below 2^31");
+    for (int i = 0; i < 4; ++i) inv *= 2 - m * inv;
+    inv = 0 - inv; // -n^-1 mod 2^32
+    r2 = (uint32_t) ((((uint64_t) 1 << 32) % m) * (((uint64_t) 1 << 32) % m) % m);
+  }
+
+  uint32_t modulus() const { return n; }
+
+  // out[i] = a[i] b[i] / 2^32 mod n, for a[i], b[i] < n; out may alias a or b.
+  void mul(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t count) const
+  {
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i vn = _mm256_set1_epi32(n), vinv = _mm256_set1_epi32(inv);
+    for (; i + 8 <= count; i += 8) {
+      const __m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+      const __m256i y = _mm256_loadu_si256((const __m256i*) (b + i));
+      _mm256_storeu_si256((__m256i*) (out + i), mul8(x, y, vn, vinv));
+    }
+#endif
+    for (; i < count; ++i) out[i] = reduce((uint64_t) a[i] * b[i]);
+  }
+
+  // Converts to and from Montgomery form; out may alias a.
+  void to(const uint32_t* a, uint32_t* out, size_t count) const
+  {
+    for (size_t i = 0; i < count; ++i) out[i] = a[i] % n;
+    std::vector<uint32_t> f(count, r2);
+    mul(out, &f[0], out, count);
+  }
+
+  void from(const uint32_t* a, uint32_t* out, size_t count) const
+  {
+    std::vector<uint32_t> one(count, 1);
+    mul(a, &one[0], out, count);
+  }
+
+  // out[i] = a[i]^e for a[i] in Montgomery form; out may alias a.
+  void pow(const uint32_t* a, unsigned long long e, uint32_t* out, size_t count) const
+  {
+    std::vector<uint32_t> base(a, a + count);
+    std::vector<uint32_t> one(count, (uint32_t) (((uint64_t) 1 << 32) % n));
+    std::copy(one.begin(), one.end(), out);
+    for (; e; e >>= 1) {
+      if (e & 1) mul(out, &base[0], out, count);
+      if (e > 1) mul(&base[0], &base[0], &base[0], count);
+    }
+  }
+
+private:
+  uint32_t n, inv, r2;
+
+  uint32_t reduce(uint64_t t) const
+  {
+    const uint32_t m = (uint32_t) t * inv;
+    const uint32_t x = (uint32_t) ((t + (uint64_t) m * n) >> 32);
+    return (x >= n ? x - n : x);
+  }
+
+#ifdef __AVX2__
+  static __m256i mul8(__m256i x, __m256i y, __m256i vn, __m256i vinv)
+  {
+    // 64-bit products of the even lanes, then of the odd lanes
+    const __m256i pe = _mm256_mul_epu32(x, y);
+    const __m256i po = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), _mm256_srli_epi64(y, 32));
+    // t + (t * inv mod 2^32) * n is a multiple of 2^32, below 2^64
+    const __m256i se = _mm256_add_epi64(pe, _mm256_mul_epu32(_mm256_mul_epu32(pe, vinv), vn));
+    const __m256i so = _mm256_add_epi64(po, _mm256_mul_epu32(_mm256_mul_epu32(po, vinv), vn));
+    const __m256i r = _mm256_blend_epi32(_mm256_srli_epi64(se, 32), so, 0xaa);
+    return _mm256_min_epu32(r, _mm256_sub_epi32(r, vn)); // r - n when r >= n
+  }
+#endif
+};
+
+} // namespace math
+} // namespace pads
+
+#endif // _PADS_MODULAR_H_
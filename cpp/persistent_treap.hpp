@@ -0,0 +1,263 @@
+#ifndef _PERSISTENT_TREAP_HPP_
+#define _PERSISTENT_TREAP_HPP_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include "splay_tree.hpp"
+
+namespace pads {
+
+////////////////////////////////////////////////////////////////////////////////
+// Persistent (Copy-On-Write) Treap
+//
+// Copying a treap is O(1): both copies share the same nodes and every node is
+// reference counted. Updates copy the search path of the nodes they modify
+// that are still shared with another version, and modify the nodes they own
+// exclusively in place, so a writer without outstanding snapshots does not
+// pay for persistence.
+//
+// A snapshot is immutable and can be handed to any number of reader threads;
+// readers never lock and never block the writer. Old versions are reclaimed
+// when the last treap referencing them goes away. snapshot() and all updates
+// must be called from the owner thread.
+
+template<typename K, typename T>
+struct persistent_node
+{
+  persistent_node* left;
+  persistent_node* right;
+  K key;
+  T value;
+  int priority;
+  std::atomic<int> refs;
+
+  persistent_node(const K& k, const T& t, int p, persistent_node* l = 0, persistent_node* r = 0)
+    : left(l), right(r), key(k), value(t), priority(p), refs(1)
+  {}
+};
+
+///
+
+template<typename K, typename T,
+         typename C = std::less<K>,
+         typename A = std::allocator<persistent_node<K, T> > >
+class persistent_treap
+{
+public:
+  persistent_treap()
+    : root(0), count(0)
+  {}
+
+  persistent_treap(const persistent_treap& rhs)
+    : comp(rhs.comp), node_alloc(rhs.node_alloc), rng(rhs.rng), root(acquire(rhs.root)), count(rhs.count)
+  {}
+
+  persistent_treap& operator=(const persistent_treap& rhs)
+  {
+    if (this != &rhs) {
+      node_type* old_root = root;
+      root = acquire(rhs.root);
+      count = rhs.count;
+      release(old_root);
+    }
+    return *this;
+  }
+
+  ~persistent_treap()
+  {
+    release(root);
+  }
+
+public:
+  // Returns an immutable version of the current contents in O(1).
+  const persistent_treap snapshot() const
+  {
+    return *this;
+  }
+
+  bool empty() const
+  {
+    return !root;
+  }
+
+  size_t size() const
+  {
+    return count;
+  }
+
+  const T* find(const K& k) const
+  {
+    const node_type* n = root;
+    while (n) {
+      if (comp(k, n->key)) {
+        n = n->left;
+      } else if (comp(n->key, k)) {
+        n = n->right;
+      } else {
+        return &n->value;
+      }
+    }
+    return 0;
+  }
+
+  bool contains(const K& k) const
+  {
+    return find(k) != 0;
+  }
+
+  const T& find_min() const
+  {
+    if (empty()) throw std::underflow_error("empty tree");
+    const node_type* n = root;
+    while (n->left) n = n->left;
+    return n->value;
+  }
+
+  const T& find_max() const
+  {
+    if (empty()) throw std::underflow_error("empty tree");
+    const node_type* n = root;
+    while (n->right) n = n->right;
+    return n->value;
+  }
+
+  bool insert(const K& k, const T& t)
+  {
+    bool added = false;
+    root = insert(root, k, t, added);
+    if (added) ++count;
+    return added;
+  }
+
+  void remove(const K& k)
+  {
+    if (!contains(k)) return; // do not copy a path for nothing
+    root = remove(root, k);
+    --count;
+  }
+
+  void clear()
+  {
+    release(root);
+    root = 0;
+    count = 0;
+  }
+
+private:
+  typedef persistent_node<K, T> node_type;
+
+  C comp;
+  typename A::template rebind<node_type>::other node_alloc;
+  lcg rng;
+
+  node_type* root;
+  size_t count;
+
+  node_type* get_new_node(const K& k, const T& t, int p, node_type* l = 0, node_type* r = 0)
+  {
+    node_type* n = node_alloc.allocate(1);
+    new (n) node_type(k, t, p, l, r);
+    return n;
+  }
+
+  static node_type* acquire(node_type* n)
+  {
+    if (n) n->refs.fetch_add(1, std::memory_order_relaxed);
+    return n;
+  }
+
+  void release(node_type* n)
+  {
+    while (n && n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      node_type* r = n->right;
+      release(n->left);
+      n->~node_type();
+      node_alloc.deallocate(n, 1);
+      n = r;
+    }
+  }
+
+  // Takes a reference to n and returns a node with the same contents that
+  // is owned exclusively by the caller.
+  node_type* own(node_type* n)
+  {
+    if (n->refs.load(std::memory_order_acquire) == 1) return n;
+    node_type* c = get_new_node(n->key, n->value, n->priority, acquire(n->left), acquire(n->right));
+    release(n);
+    return c;
+  }
+
+  static node_type* left_rotation(node_type* n)
+  {
+    node_type* k = n->left;
+    n->left = k->right;
+    k->right = n;
+    return k;
+  }
+
+  static node_type* right_rotation(node_type* n)
+  {
+    node_type* k = n->right;
+    n->right = k->left;
+    k->left = n;
+    return k;
+  }
+
+  node_type* insert(node_type* n, const K& k, const T& t, bool& added)
+  {
+    if (!n) {
+      added = true;
+      return get_new_node(k, t, rng.random_integer());
+    }
+
+    n = own(n);
+    if (comp(k, n->key)) {
+      n->left = insert(n->left, k, t, added);
+      if (n->left->priority > n->priority) n = left_rotation(n);
+    } else if (comp(n->key, k)) {
+      n->right = insert(n->right, k, t, added);
+      if (n->right->priority > n->priority) n = right_rotation(n);
+    } else {
+      n->value = t;
+    }
+    return n;
+  }
+
+  node_type* remove(node_type* n, const K& k)
+  {
+    n = own(n);
+    if (comp(k, n->key)) {
+      n->left = remove(n->left, k);
+    } else if (comp(n->key, k)) {
+      n->right = remove(n->right, k);
+    } else {
+      node_type* m = merge(n->left, n->right);
+      n->~node_type();
+      node_alloc.deallocate(n, 1);
+      return m;
+    }
+    return n;
+  }
+
+  // Joins two treaps whose keys are ordered (all keys of l before those of r).
+  node_type* merge(node_type* l, node_type* r)
+  {
+    if (!l) return r;
+    if (!r) return l;
+    if (l->priority > r->priority) {
+      l = own(l);
+      l->right = merge(l->right, r);
+      return l;
+    } else {
+      r = own(r);
+      r->left = merge(l, r->left);
+      return r;
+    }
+  }
+};
+
+} // namespace pads
+
+#endif // _PERSISTENT_TREAP_HPP_
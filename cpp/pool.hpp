@@ -0,0 +1,113 @@
+#ifndef _POOL_HPP_
+#define _POOL_HPP_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace pads {
+
+////////////////////////////////////////////////////////////////////////////////
+// Object Pool
+//
+// Allocates objects of type T from blocks of N slots. Freed slots are reused
+// first; the blocks are only released, all at once, by clear() or the
+// destructor, which do not run the destructors of the objects still alive.
+
+template<typename T, size_t N = 1024>
+class object_pool
+{
+public:
+  object_pool()
+    : free_list(0), next(N)
+  {}
+
+  ~object_pool()
+  {
+    clear();
+  }
+
+  T* create(const T& t)
+  {
+    return new (allocate()) T(t);
+  }
+
+  void destroy(T* p)
+  {
+    p->~T();
+    deallocate(p);
+  }
+
+  void* allocate()
+  {
+    if (free_list) {
+      slot* s = free_list;
+      free_list = s->next;
+      return s;
+    }
+    if (next == N) {
+      blocks.push_back(new slot[N]);
+      next = 0;
+    }
+    return &blocks.back()[next++];
+  }
+
+  void deallocate(void* p)
+  {
+    slot* s = static_cast<slot*>(p);
+    s->next = free_list;
+    free_list = s;
+  }
+
+  void clear()
+  {
+    for (size_t i = 0; i < blocks.size(); ++i) delete[] blocks[i];
+    blocks.clear();
+    free_list = 0;
+    next = N;
+  }
+
+  // Takes over the blocks of other, whose objects stay where they are and
+  // now belong to this pool; other is left empty. Linear in the number of
+  // free slots of other.
+  void splice(object_pool& other)
+  {
+    if (&other == this || other.blocks.empty()) return;
+    // the unused tail of our last block would be lost behind other's blocks
+    while (next < N) deallocate(&blocks.back()[next++]);
+    while (other.next < N) other.deallocate(&other.blocks.back()[other.next++]);
+    while (other.free_list) {
+      slot* s = other.free_list;
+      other.free_list = s->next;
+      deallocate(s);
+    }
+    blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+    other.blocks.clear();
+    other.next = N;
+    next = N;
+  }
+
+  size_t capacity() const
+  {
+    return blocks.size() * N;
+  }
+
+private:
+  union slot
+  {
+    slot* next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  std::vector<slot*> blocks;
+  slot* free_list;
+  size_t next; // first unused slot of the last block
+
+  object_pool(const object_pool&);
+  object_pool& operator=(const object_pool&);
+};
+
+} // namespace pads
+
+#endif // _POOL_HPP_
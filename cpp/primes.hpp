@@ -1,99 +1,465 @@
+#ifndef _PADS_PRIMES_H_
+#define _PADS_PRIMES_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <stdint.h>
+#include <thread>
+#include <vector>
 #include "integer.hpp"
+#include "mapped_file.hpp"
+#include "static_primes.hpp"
 
 namespace pads {
 namespace math {
 
+////////////////////////////////////////////////////////////////////////////////
+// Sieving and Primality Helpers
+
+namespace detail {
+
+// floor(sqrt(n))
+inline integer isqrt(integer n)
+{
+  integer r = (integer) std::sqrt((double) n);
+  while (r * r > n) --r;
+  while ((r + 1) * (r + 1) <= n) ++r;
+  return r;
+}
+
+// Primes up to n (sieve of Eratosthenes).
+inline std::vector<integer> sieve(integer n)
+{
+  std::vector<integer> p;
+  std::vector<char> composite(n + 1);
+  for (integer i = 2; i <= n; ++i) {
+    if (composite[i]) continue;
+    p.push_back(i);
+    for (integer j = i * i; j <= n; j += i) composite[j] = 1;
+  }
+  return p;
+}
+
+// Calls f(p) for the primes p of [lo, hi[ in increasing order, sieving
+// windows of odd numbers with the primes up to sqrt(hi), until f returns
+// false. Returns whether the interval was entirely scanned.
+template<typename F>
+bool sieve_range(integer lo, integer hi, F f)
+{
+  enum { W = 1 << 18 }; // odd numbers per window
+  if (lo < 2) lo = 2;
+  if (lo >= hi) return true;
+  if (lo == 2 && !f(2)) return false;
+  const std::vector<integer> base = sieve(isqrt(hi - 1));
+  std::vector<char> composite(W);
+  for (integer w = lo | 1; w < hi; w += 2 * W) { // composite[i] is w + 2i
+    const integer end = std::min<integer>(w + 2 * W, hi);
+    std::fill(composite.begin(), composite.end(), 0);
+    for (size_t i = 1; i < base.size() && base[i] * base[i] < end; ++i) {
+      const integer p = base[i];
+      integer j = std::max(p * p, (w + p - 1) / p * p);
+      if (even(j)) j += p;
+      for (; j < end; j += 2 * p) composite[(j - w) >> 1] = 1;
+    }
+    for (integer n = w; n < end; n += 2) {
+      if (n > 1 && !composite[(n - w) >> 1] && !f(n)) return false;
+    }
+  }
+  return true;
+}
+
+// distance from r to the next (wheel_next) or previous (wheel_prev) residue
+// coprime to 2*3*5*7, r included
+constexpr std::array<unsigned char, 210> make_wheel(int direction)
+{
+  std::array<unsigned char, 210> w{};
+  for (int r = 0; r < 210; ++r) {
+    int d = 0;
+    while (gcd(((r + direction * d) % 210 + 210) % 210, 210) != 1) ++d;
+    w[r] = d;
+  }
+  return w;
+}
+
+inline constexpr std::array<unsigned char, 210> wheel_next = make_wheel(1);
+inline constexpr std::array<unsigned char, 210> wheel_prev = make_wheel(-1);
+
+// Strong probable prime test to base 2 of four odd numbers > 2 at once: the
+// four exponentiations are interleaved so that their multiplications overlap.
+inline void sprp2(const integer n[4], bool prime[4])
+{
+  montgomery m[4] = { montgomery(n[0]), montgomery(n[1]), montgomery(n[2]), montgomery(n[3]) };
+  unsigned long long d[4], x[4];
+  int s[4], top = 0;
+  for (int i = 0; i < 4; ++i) {
+    s[i] = __builtin_ctzll(n[i] - 1);
+    d[i] = (n[i] - 1) >> s[i];
+    x[i] = m[i].r;
+    top = std::max(top, 63 - __builtin_clzll(d[i]));
+  }
+  // left to right: multiplying by the base 2 is a doubling
+  for (int b = top; b >= 0; --b) {
+    for (int i = 0; i < 4; ++i) {
+      x[i] = m[i].mul(x[i], x[i]);
+      if ((d[i] >> b) & 1) {
+        x[i] <<= 1;
+        if (x[i] >= m[i].n) x[i] -= m[i].n;
+      }
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    const unsigned long long minus_one = m[i].n - m[i].r;
+    prime[i] = (x[i] == m[i].r || x[i] == minus_one);
+    for (int r = 1; !prime[i] && r < s[i]; ++r) {
+      x[i] = m[i].mul(x[i], x[i]);
+      prime[i] = (x[i] == minus_one);
+    }
+  }
+}
+
+// Deterministic Miller-Rabin for odd n > 2 (Sinclair's 7 bases cover 2^64).
+inline bool miller_rabin(integer n)
+{
+  static const integer bases[7] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+  const montgomery m(n);
+  for (int i = 0; i < 7; ++i) {
+    if (bases[i] % n != 0 && !strong_probable_prime(m, bases[i])) return false;
+  }
+  return true;
+}
+
+// floor(x / d), with a double division (exact below 2^53) when possible
+inline integer quotient(integer x, integer d)
+{
+  return (x < (1LL << 52) ? (integer) ((double) x / (double) d) : x / d);
+}
+
+// Whether parallel_for() splits [lo, hi[ among threads.
+inline bool parallel(integer lo, integer hi, unsigned threads)
+{
+  return threads > 1 && hi - lo >= (1 << 16);
+}
+
+// Runs f(first, last) on [lo, hi[ split among the given number of threads.
+template<typename F>
+void parallel_for(integer lo, integer hi, unsigned threads, F f)
+{
+  if (!parallel(lo, hi, threads)) {
+    f(lo, hi);
+    return;
+  }
+  std::vector<std::thread> workers;
+  const integer step = (hi - lo + threads - 1) / threads;
+  for (integer first = lo; first < hi; first += step) {
+    workers.push_back(std::thread(f, first, std::min(first + step, hi)));
+  }
+  for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+}
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+// Concurrent Prime Cache
+//
+// Append-only set shared by all threads: open addressing with linear probing
+// over a fixed table of atomic slots. Lookups never lock and never wait; an
+// insertion claims an empty slot with a CAS. Once half full, new primes are
+// no longer cached.
+
+class prime_cache
+{
+public:
+  explicit prime_cache(int log_capacity = 16)
+    : shift(64 - log_capacity), mask(((size_t) 1 << log_capacity) - 1), count(0),
+      slots(new std::atomic<integer>[mask + 1])
+  {
+    for (size_t i = 0; i <= mask; ++i) slots[i].store(0, std::memory_order_relaxed);
+  }
+
+  ~prime_cache()
+  {
+    delete[] slots;
+  }
+
+  bool contains(integer n) const
+  {
+    for (size_t i = hash(n); ; i = (i + 1) & mask) {
+      const integer v = slots[i].load(std::memory_order_acquire);
+      if (v == n) return true;
+      if (!v) return false;
+    }
+  }
+
+  void insert(integer n)
+  {
+    if (count.load(std::memory_order_relaxed) > mask / 2) return;
+    for (size_t i = hash(n); ; i = (i + 1) & mask) {
+      integer v = slots[i].load(std::memory_order_acquire);
+      if (!v) {
+        if (slots[i].compare_exchange_strong(v, n, std::memory_order_acq_rel)) {
+          count.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+      }
+      if (v == n) return;
+    }
+  }
+
+  size_t size() const
+  {
+    return count.load(std::memory_order_relaxed);
+  }
+
+private:
+  const int shift;
+  const size_t mask;
+  std::atomic<size_t> count;
+  std::atomic<integer>* slots;
+
+  size_t hash(integer n) const
+  {
+    return (size_t) (((unsigned long long) n * 0x9E3779B97F4A7C15ULL) >> shift);
+  }
+
+  prime_cache(const prime_cache&);
+  prime_cache& operator=(const prime_cache&);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Prime Table Files
+//
+// Layout, in native byte order:
+//  - a prime_table_header;
+//  - the bitset at bits_offset: byte i covers [30i, 30i + 30[, bit j being
+//    set when 30i + wheel_residues[j] is prime (2, 3 and 5 are implicit);
+//  - the index at index_offset: index[c] is the number of primes of the
+//    bitset before byte c * interval, followed by the total.
+// Both sections start on 8-byte boundaries. The limit is a multiple of
+// 30 * interval so that the bitset is made of whole checkpoint blocks.
+
+struct prime_table_header
+{
+  char magic[8];          // "PADSPRIM"
+  uint32_t version;       // prime_table_version
+  uint32_t byte_order;    // 0x01020304 as written
+  uint64_t limit;         // the table covers [0, limit[
+  uint64_t count;         // primes below limit
+  uint64_t interval;      // bitset bytes between checkpoints, a multiple of 8
+  uint64_t bits_offset;
+  uint64_t bits_size;     // limit / 30 bytes
+  uint64_t index_offset;
+  uint64_t index_size;    // bits_size / interval + 1 entries
+};
+
+enum { prime_table_version = 1 };
+
+///
+
+class prime_table_file
+{
+public:
+  // Maps the file read-only, in O(1): nothing is read beyond the header.
+  explicit prime_table_file(const std::string& path)
+    : file(path), header(reinterpret_cast<const prime_table_header*>(file.data()))
+  {
+    if (file.size() < sizeof(prime_table_header) || std::memcmp(header->magic, "PADSPRIM", 8) != 0) {
+      throw std::runtime_error(path + " is not a prime table");
+    }
+    if (header->version != prime_table_version || header->byte_order != 0x01020304) {
+      throw std::runtime_error(path + ": unsupported prime table version or byte order");
+    }
+    if (header->bits_offset + header->bits_size > file.size() ||
+        header->index_offset + 8 * header->index_size > file.size() ||
+        header->index_size != header->bits_size / header->interval + 1) {
+      throw std::runtime_error(path + " is truncated");
+    }
+    bits = reinterpret_cast<const unsigned char*>(file.data() + header->bits_offset);
+    index = reinterpret_cast<const uint64_t*>(file.data() + header->index_offset);
+  }
+
+  integer limit() const { return header->limit; }
+  integer count() const { return header->count; }
+
+  // Whether n is prime, for 0 <= n < limit(): a single bit test.
+  bool contains(integer n) const
+  {
+    if (n < 7) return n == 2 || n == 3 || n == 5;
+    const unsigned char bit = residue_bit[n % 30];
+    return bit && (bits[n / 30] & bit);
+  }
+
+  // Number of primes <= x, for x < limit(): one checkpoint and at most
+  // interval bytes of popcounts.
+  integer pi(integer x) const
+  {
+    if (x < 7) return (x >= 2) + (x >= 3) + (x >= 5);
+    const uint64_t byte = (x + 1) / 30, block = byte / header->interval;
+    integer n = 3 + index[block];
+    const uint64_t* w = reinterpret_cast<const uint64_t*>(bits + block * header->interval);
+    const uint64_t* end = reinterpret_cast<const uint64_t*>(bits + (byte & ~(uint64_t) 7));
+    for (; w < end; ++w) n += __builtin_popcountll(*w);
+    for (uint64_t b = byte & ~(uint64_t) 7; b < byte; ++b) n += __builtin_popcount(bits[b]);
+    if (byte < header->bits_size) n += __builtin_popcount(bits[byte] & below[(x + 1) % 30]);
+    return n;
+  }
+
+  // k-th prime (nth(1) = 2), for k <= count(); 0 otherwise.
+  integer nth(integer k) const
+  {
+    static const integer first[4] = { 0, 2, 3, 5 };
+    if (k < 1 || k > count()) return 0;
+    if (k < 4) return first[k];
+    uint64_t r = k - 3;
+    // last checkpoint with fewer than r primes before it
+    const uint64_t block = std::lower_bound(index, index + header->index_size, r) - index - 1;
+    r -= index[block];
+    const uint64_t* w = reinterpret_cast<const uint64_t*>(bits + block * header->interval);
+    for (unsigned c; r > (c = __builtin_popcountll(*w)); ++w) r -= c;
+    uint64_t b = reinterpret_cast<const unsigned char*>(w) - bits;
+    for (unsigned c; r > (c = __builtin_popcount(bits[b])); ++b) r -= c;
+    unsigned char m = bits[b];
+    while (--r) m &= m - 1;
+    return 30 * (integer) b + wheel_residues[__builtin_ctz(m)];
+  }
+
+  // Writes the table of the primes below limit (rounded up to a whole
+  // checkpoint block) to path; throws std::runtime_error on failure.
+  static void write(const std::string& path, integer limit, uint64_t interval = 256)
+  {
+    const uint64_t block = 30 * interval;
+    prime_table_header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "PADSPRIM", 8);
+    h.version = prime_table_version;
+    h.byte_order = 0x01020304;
+    h.limit = (std::max<integer>(limit, 1) + block - 1) / block * block;
+    h.interval = interval;
+    h.bits_offset = (sizeof(h) + 7) & ~(uint64_t) 7;
+    h.bits_size = h.limit / 30;
+    h.index_offset = h.bits_offset + h.bits_size;
+    h.index_size = h.bits_size / interval + 1;
+
+    std::vector<unsigned char> bits(h.bits_size);
+    detail::sieve_range(7, h.limit, [&bits](integer p) {
+      bits[p / 30] |= residue_bit[p % 30];
+      return true;
+    });
+    std::vector<uint64_t> index(h.index_size);
+    for (uint64_t c = 0; c + 1 < h.index_size; ++c) {
+      uint64_t n = 0;
+      for (uint64_t b = c * interval; b < (c + 1) * interval; ++b) n += __builtin_popcount(bits[b]);
+      index[c + 1] = index[c] + n;
+    }
+    h.count = 3 + index.back();
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot create " + path);
+    const bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1
+                 && std::fseek(f, h.bits_offset, SEEK_SET) == 0
+                 && std::fwrite(bits.data(), 1, bits.size(), f) == bits.size()
+                 && std::fwrite(index.data(), 8, index.size(), f) == index.size();
+    if (std::fclose(f) != 0 || !ok) throw std::runtime_error("cannot write " + path);
+  }
+
+private:
+  mapped_file file;
+  const prime_table_header* header;
+  const unsigned char* bits;
+  const uint64_t* index;
+
+  static constexpr unsigned char wheel_residues[8] = { 1, 7, 11, 13, 17, 19, 23, 29 };
+  // bit of each residue mod 30 in a bitset byte (0 if not coprime to 30),
+  // and mask of the bits of the residues below r
+  static constexpr unsigned char residue_bit[30] = {
+    0, 1, 0, 0, 0, 0, 0, 2, 0, 0, 0, 4, 0, 8, 0, 0, 0, 16, 0, 32, 0, 0, 0, 64, 0, 0, 0, 0, 0, 128 };
+  static constexpr unsigned char below[30] = {
+    0, 0, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 7, 7, 15, 15, 15, 15, 31, 31, 63, 63, 63, 63, 127, 127, 127, 127, 127, 127 };
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Primes
+//
+// Stateless and thread-safe: the primes up to lkp come from a process-wide
+// immutable table, the larger primes found along the way are shared by all
+// instances through a concurrent cache.
+
 class primes
 {
 public:
-  primes()
-    : lkp(997)
-  {
-    const int p[168] = {
-      2,3,5,7,11,13,17,19,23,29,31,37,41,43,47,53,59,61,67,71,73,79,83,89,97,
-      101,103,107,109,113,127,131,137,139,149,151,157,163,167,173,179,181,191,193,197,199,
-      211,223,227,229,233,239,241,251,257,263,269,271,277,281,283,293,
-      307,311,313,317,331,337,347,349,353,359,367,373,379,383,389,397,
-      401,409,419,421,431,433,439,443,449,457,461,463,467,479,487,491,499,
-      503,509,521,523,541,547,557,563,569,571,577,587,593,599,
-      601,607,613,617,619,631,641,643,647,653,659,661,673,677,683,691,
-      701,709,719,727,733,739,743,751,757,761,769,773,787,797,
-      809,811,821,823,827,829,839,853,857,859,863,877,881,883,887,
-      907,911,919,929,937,941,947,953,967,971,977,983,991,997,
-    };
-    _primes.insert(&p[0], &p[168]);
-  }
-
-  typedef std::set<integer>::const_iterator const_iterator;
-  const_iterator begin() const { return _primes.begin(); }
-  const_iterator end()   const { return _primes.end();   }
+  enum { lkp = 997 }; // last known prime
+
+  typedef const integer* const_iterator;
+  const_iterator begin() const { return table(); }
+  const_iterator end()   const { return table() + 168; }
 
   typedef std::map<integer, size_t> factors;
-  void factorize(integer n, factors& f)
+  void factorize(integer n, factors& f) const
   {
     f.clear();
     if (n < 2) return;
 
-    if (_primes.count(n)) {
-      f[n] = 1;
-    } else {
-      integer p, d = n;
-      for (const_iterator it = _primes.begin(), end = _primes.end(); it != end; ++it) {
-        p = *it;
-        size_t count = 0;
-        while (d % p == 0) {
-          ++count;
-          d /= p;
-        }
-        if (count) f[p] = count;
+    integer d = n;
+    for (const_iterator it = begin(), end = this->end(); it != end && (*it) * (*it) <= d; ++it) {
+      const integer p = *it;
+      size_t count = 0;
+      while (d % p == 0) {
+        ++count;
+        d /= p;
       }
+      if (count) f[p] = count;
+    }
 
-      const integer max = (integer) std::sqrt((double)n) + 1;
-      for (integer i = lkp+2; d != 1 && i < max; i += 2) {
-        if (n % i == 0) {
-          _primes.insert(i);
-          size_t count = 0;
-          do {
-            d /= i;
-            ++count;
-          } while (n % i == 0);
-          if (count) f[i] = count;
-        }
+    for (integer i = lkp+2; i * i <= d; i += 2) {
+      if (d % i == 0) {
+        cache().insert(i);
+        size_t count = 0;
+        do {
+          d /= i;
+          ++count;
+        } while (d % i == 0);
+        f[i] = count;
       }
+    }
 
-      if (d != 1) {
-        _primes.insert(d);
-        f[d] = 1;
-      }
+    if (d != 1) {
+      if (d > lkp) cache().insert(d);
+      f[d] = 1;
     }
   }
 
-  bool is_prime(integer n)
+  bool is_prime(integer n) const
   {
     if (n < 2) return false;
-    if (n == 2) return true;
-    if (even(n)) return false;
-    if (_primes.count(n)) return true;
+    if (const prime_table_file* t = loaded(n)) return t->contains(n);
+    if (n <= lkp) return std::binary_search(begin(), end(), n);
+    if (cache().contains(n)) return true;
 
-    for (const_iterator it = _primes.begin(), end = _primes.end(); it != end; ++it) {
+    for (const_iterator it = begin(), end = this->end(); it != end; ++it) {
       if (n % (*it) == 0) return false;
     }
 
-    const integer max = (integer) std::sqrt((double)n);
-    for (integer i = lkp+2; i < max; i += 2) {
-      if (n % i == 0) {
-        _primes.insert(i);
-        return false;
-      }
+    for (integer i = lkp+2; i * i <= n; i += 2) {
+      if (n % i == 0) return false;
     }
 
-    _primes.insert(n);
+    cache().insert(n);
     return true;
   }
 
-  bool fast_miller_rabin(integer n)
+  bool fast_miller_rabin(integer n) const
   {
-    if (_primes.count(n)) return true;
+    if (n <= lkp) return is_prime(n);
+    if (const prime_table_file* t = loaded(n)) return t->contains(n);
+    if (cache().contains(n)) return true;
+    if (even(n)) return false;
+    residue::set_modulus(n);
     if (miller_rabin_witness(n,  2)) return false;
     if (miller_rabin_witness(n,  3)) return false;
     if (miller_rabin_witness(n,  5)) return false;
@@ -104,47 +470,277 @@ public:
     if (miller_rabin_witness(n, 31)) return false;
     if (miller_rabin_witness(n, 73)) return false;
     if (miller_rabin_witness(n, 61)) return false;
-    _primes.insert(n);
+    cache().insert(n);
     return true;
   }
 
-  integer next_prime(integer n)
+  integer next_prime(integer n) const
   {
-    if (n < 2) return 2;
-    if (n == 2) return 3;
-    n += (odd(n)?2:1); // next odd
-    while (!is_prime(n)) n += 2;
-    return n;
+    if (n < lkp) return *std::upper_bound(begin(), end(), n);
+
+    // candidates coprime to 210, tested 4 at a time
+    integer c[4];
+    bool sprp[4];
+    for (integer x = n + 1; ; ) {
+      for (int i = 0; i < 4; ++i) {
+        x += detail::wheel_next[x % 210];
+        c[i] = x++;
+      }
+      detail::sprp2(c, sprp);
+      for (int i = 0; i < 4; ++i) {
+        if (sprp[i] && detail::miller_rabin(c[i])) return c[i];
+      }
+    }
   }
 
-  integer prev_prime(integer n)
+  integer prev_prime(integer n) const
   {
-    if (n <= 2) return 0;
-    if (n == 3) return 2;
-    n -= (odd(n)?2:1); // prev odd
-    while (!is_prime(n)) n -= 2;
-    return n;
+    if (n <= lkp + 1) {
+      const_iterator it = std::lower_bound(begin(), end(), n);
+      return (it == begin() ? 0 : *--it);
+    }
+
+    integer c[4];
+    bool sprp[4];
+    for (integer x = n - 1; ; ) {
+      for (int i = 0; i < 4; ++i) {
+        x -= detail::wheel_prev[x % 210];
+        c[i] = x--;
+      }
+      detail::sprp2(c, sprp);
+      for (int i = 0; i < 4; ++i) {
+        if (sprp[i] && detail::miller_rabin(c[i])) return c[i];
+      }
+    }
+  }
+
+  // Writes the primes of [lo, hi[ to out (segmented sieve).
+  template<typename OutputIterator>
+  OutputIterator primes_in_range(integer lo, integer hi, OutputIterator out) const
+  {
+    detail::sieve_range(lo, hi, [&out](integer p) {
+      *out++ = p;
+      return true;
+    });
+    return out;
+  }
+
+  // The cache shared by all instances.
+  static prime_cache& cache()
+  {
+    static prime_cache c;
+    return c;
+  }
+
+  // Maps a prime table file, which from then on answers is_prime() and
+  // fast_miller_rabin() below its limit, as well as prime_count() and
+  // nth_prime(). A table replaced by a later load() stays mapped, since
+  // other threads may still be reading it.
+  static void load(const std::string& path)
+  {
+    table_file().store(new prime_table_file(path), std::memory_order_release);
+  }
+
+  // The loaded table if it covers n, null otherwise.
+  static const prime_table_file* loaded(integer n = 0)
+  {
+    const prime_table_file* t = table_file().load(std::memory_order_acquire);
+    return (t && n < t->limit() ? t : 0);
   }
 
 private:
-  std::set<integer> _primes;
-  const integer lkp; // last known prime
+  static std::atomic<const prime_table_file*>& table_file()
+  {
+    static std::atomic<const prime_table_file*> t(0);
+    return t;
+  }
+
+  static const integer* table()
+  {
+    static constexpr std::array<integer, 168> p = prime_table<168>();
+    return p.data();
+  }
+
+  // residues modulo the number being tested, per thread
+  typedef modular<primes> residue;
 
-  bool miller_rabin_witness(integer n, integer a)
+  // a is a witness of the compositeness of odd n (residue's modulus).
+  bool miller_rabin_witness(integer n, integer a) const
   {
     integer t = 0;
     integer u = n-1;
     while (even(u)) { ++t; u >>= 1; }
-    integer x = modexp(a, u, n);
+    const residue one = 1, minus_one = -one;
+    residue x = pow(residue(a), u);
     for (integer i = 1; i <= t; ++i) {
-      integer y = (x * x) % n;
-      if (y == 1 && x != 1 && x != n-1) return true;
+      const residue y = x * x;
+      if (y == one && x != one && x != minus_one) return true;
       x = y;
     }
-    if (x != 1) return true;
+    if (x != one) return true;
     return false;
   }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Prime Counting
+
+// Number of primes <= x (Lucy_Hedgehog's algorithm, O(x^(3/4)) time and
+// O(x^(1/2)) space). S(v) counts the integers of [2, v] that are prime or
+// have no prime factor below the current p, for the O(sqrt(x)) values
+// v = x / i; sieving by each prime p <= sqrt(x) in turn leaves S(x) = pi(x).
+// Large sieving steps are split among threads. Below the limit of a loaded
+// prime table, pi(x) is read from the table instead.
+inline integer prime_count(integer x, unsigned threads = std::thread::hardware_concurrency())
+{
+  if (x < 2) return 0;
+  if (const prime_table_file* t = primes::loaded(x)) return t->pi(x);
+  const integer r = detail::isqrt(x);
+
+  // small[v] = S(v) for v <= r, large[i] = S(x / i) for i <= r
+  std::vector<integer> small(r + 1), large(r + 1), updated(threads > 1 ? r + 1 : 0);
+  for (integer i = 1; i <= r; ++i) {
+    small[i] = i - 1;
+    large[i] = detail::quotient(x, i) - 1;
+  }
+
+  for (integer p = 2; p <= r; ++p) {
+    if (small[p] == small[p-1]) continue; // not a prime
+    const integer sp = small[p-1];
+    const integer p2 = p * p;
+
+    // every S(v) with v >= p^2 loses the numbers whose smallest prime factor
+    // is p. S(v / p) must be the old value: serial loops update large[] by
+    // increasing i and small[] by decreasing v, parallel ones compute the new
+    // values aside before storing them.
+    const integer last = std::min(r, detail::quotient(x, p2));
+    if (!detail::parallel(1, last + 1, threads)) {
+      for (integer i = 1; i <= last; ++i) {
+        const integer d = i * p;
+        large[i] -= (d <= r ? large[d] : small[detail::quotient(x, d)]) - sp;
+      }
+    } else {
+      detail::parallel_for(1, last + 1, threads, [&](integer first, integer end) {
+        for (integer i = first; i < end; ++i) {
+          const integer d = i * p;
+          updated[i] = large[i] - ((d <= r ? large[d] : small[detail::quotient(x, d)]) - sp);
+        }
+      });
+      std::copy(updated.begin() + 1, updated.begin() + last + 1, large.begin() + 1);
+    }
+
+    if (!detail::parallel(p2, r + 1, threads)) {
+      for (integer v = r; v >= p2; --v) {
+        small[v] -= small[v / p] - sp;
+      }
+    } else {
+      detail::parallel_for(p2, r + 1, threads, [&](integer first, integer end) {
+        for (integer v = first; v < end; ++v) {
+          updated[v] = small[v] - (small[v / p] - sp);
+        }
+      });
+      std::copy(updated.begin() + p2, updated.begin() + r + 1, small.begin() + p2);
+    }
+  }
+  return large[1];
+}
+
+// k-th prime (nth_prime(1) = 2): counts the primes up to a lower bound of
+// p_k with prime_count() and sieves the remaining interval, unless a loaded
+// prime table holds p_k.
+inline integer nth_prime(integer k, unsigned threads = std::thread::hardware_concurrency())
+{
+  static const integer first[6] = { 0, 2, 3, 5, 7, 11 };
+  if (k < 1) return 0;
+  if (k < 6) return first[k];
+  if (const prime_table_file* t = primes::loaded()) {
+    if (k <= t->count()) return t->nth(k);
+  }
+
+  // Dusart: k (ln k + ln ln k - 1) < p_k < k (ln k + ln ln k) for k >= 6
+  const double lk = std::log((double) k), llk = std::log(lk);
+  const integer lo = (integer) (k * (lk + llk - 1));
+  const integer hi = (integer) (k * (lk + llk)) + 1;
+
+  integer count = prime_count(lo, threads);
+  integer p = 0;
+  detail::sieve_range(lo + 1, hi + 1, [&](integer n) {
+    p = n;
+    return ++count < k;
+  });
+  return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Probable Primes of Any Size
+//
+// For integer as well as big_integer. Trial division by the primes below 1000
+// is followed by Miller-Rabin with the first rounds primes as bases, which is
+// deterministic below 3.3e24 (13 bases); beyond that, fixed bases are only
+// reliable for numbers not constructed to fool them.
+
+template<typename I>
+bool is_probable_prime(const I& n, int rounds = 24)
+{
+  static constexpr std::array<integer, 168> small = prime_table<168>();
+  if (n < I(2)) return false;
+  for (int i = 0; i < 168; ++i) {
+    if (n == I(small[i])) return true;
+    if (n % I(small[i]) == I(0)) return false;
+  }
+  if (n < I(997 * 997)) return true;
+
+  const I minus_one = n - I(1);
+  I d = minus_one;
+  int s = 0;
+  while (even(d)) {
+    d = d / I(2);
+    ++s;
+  }
+  for (int i = 0; i < rounds && i < 168; ++i) {
+    I x = modexp(I(small[i]), d, n);
+    if (x == I(1) || x == minus_one) continue;
+    int r = 1;
+    for (; r < s && x != minus_one; ++r) x = mulmod(x, x, n);
+    if (x != minus_one) return false;
+  }
+  return true;
+}
+
+// Smallest probable prime > n.
+template<typename I>
+I next_probable_prime(const I& n)
+{
+  if (n < I(2)) return I(2);
+  I x = n + I(1);
+  if (even(x)) x = x + I(1);
+  while (!is_probable_prime(x)) x = x + I(2);
+  return x;
+}
+
 } // namespace math
 } // namespace pads
+
+#ifdef PRIME_TABLE_GENERATOR
+#include <cstdlib>
+#include <iostream>
+// Writes the table of the primes below argv[1] to argv[2].
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cerr << "usage: " << argv[0] << " limit path" << std::endl;
+    return 1;
+  }
+  try {
+    pads::math::prime_table_file::write(argv[2], std::atoll(argv[1]));
+    const pads::math::prime_table_file t(argv[2]);
+    std::cout << t.count() << " primes below " << t.limit() << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+#endif
+
+#endif // _PADS_PRIMES_H_
@@ -2,6 +2,13 @@
 #define _PADS_RANDOM_H_
 
 #include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <stdint.h>
 #include <math.h>
 #include <stdlib.h>
 
@@ -62,6 +69,567 @@ RAI selection(RAI first, RAI last, Predicate pred)
   return last;
 }
 
+/// Engines ///
+
+// The samplers below take any engine returning 64 random bits per call, such
+// as the following ones or std::mt19937_64.
+
+// xoshiro256** (Blackman and Vigna): fast, 2^256 - 1 period.
+class xoshiro256
+{
+public:
+  typedef uint64_t result_type;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~(result_type) 0; }
+
+  explicit xoshiro256(uint64_t seed = 1)
+  {
+    // state filled by splitmix64, never all zero
+    for (int i = 0; i < 4; ++i) {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      s[i] = z ^ (z >> 31);
+    }
+  }
+
+  result_type operator()()
+  {
+    const uint64_t r = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return r;
+  }
+
+private:
+  uint64_t s[4];
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// The global drand48 state, as an engine (seeded by seed()).
+struct drand48_engine
+{
+  typedef uint64_t result_type;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~(result_type) 0; }
+
+  result_type operator()()
+  {
+    return (uint64_t) (uint32_t) ::mrand48() << 32 | (uint32_t) ::mrand48();
+  }
+};
+
+// Returns a double uniformly distributed in [0, 1[ (53 random bits).
+template<typename Engine>
+double uniform(Engine& e)
+{
+  return (e() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Returns an integer uniformly distributed in [0, n[, for n > 0 (Lemire's
+// multiply and shift, with rejection of the few biased products).
+template<typename Engine>
+uint64_t uniform_integer(Engine& e, uint64_t n)
+{
+  unsigned __int128 m = (unsigned __int128) e() * n;
+  if ((uint64_t) m < n) {
+    const uint64_t threshold = (0 - n) % n;
+    while ((uint64_t) m < threshold) m = (unsigned __int128) e() * n;
+  }
+  return (uint64_t) (m >> 64);
+}
+
+/// Non-Uniform Distributions ///
+
+namespace detail {
+
+// Ziggurat tables (Marsaglia and Tsang) for f(x) = exp(-x^2/2) with 128 layers
+// and f(x) = exp(-x) with 256 layers. Layer i covers [0, x[i][ between the
+// heights f(x[i]) and f(x[i+1]); x[0] = V / f(R) stands for the base layer,
+// which includes the tail beyond R. Points with |u| x[i] < x[i+1] are inside
+// the curve whatever their height, which is nearly 99% of them.
+template<int N>
+struct ziggurat
+{
+  double x[N+1], ratio[N], f[N+1];
+  double r;
+
+  template<typename F, typename Inverse>
+  ziggurat(double R, double V, F density, Inverse inverse)
+    : r(R)
+  {
+    x[0] = V / density(R);
+    x[1] = R;
+    for (int i = 2; i < N; ++i) x[i] = inverse(V / x[i-1] + density(x[i-1]));
+    x[N] = 0;
+    for (int i = 0; i <= N; ++i) f[i] = density(x[i]);
+    for (int i = 0; i < N; ++i) ratio[i] = x[i+1] / x[i];
+  }
+};
+
+inline const ziggurat<128>& normal_ziggurat()
+{
+  static const ziggurat<128> z(3.442619855899, 9.91256303526217e-3,
+                               [](double x) { return ::exp(-0.5 * x * x); },
+                               [](double y) { return ::sqrt(-2 * ::log(y)); });
+  return z;
+}
+
+inline const ziggurat<256>& exponential_ziggurat()
+{
+  static const ziggurat<256> z(7.69711747013104972, 3.949659822581572e-3,
+                               [](double x) { return ::exp(-x); },
+                               [](double y) { return -::log(y); });
+  return z;
+}
+
+// A standard normal sample, given the first 64 random bits: 7 select the
+// layer, 1 the sign and 53 the abscissa.
+template<typename Engine>
+double normal(Engine& e, const ziggurat<128>& z, uint64_t bits)
+{
+  for (;; bits = e()) {
+    const int i = bits & 127;
+    const double u = (bits >> 11) * (1.0 / 9007199254740992.0) * ((bits & 128) ? -1 : 1);
+    if (::fabs(u) < z.ratio[i]) return u * z.x[i];
+    if (i == 0) { // tail: Marsaglia's method
+      double a, b;
+      do {
+        a = -::log(1 - uniform(e)) / z.r;
+        b = -::log(1 - uniform(e));
+      } while (b + b < a * a);
+      return (u < 0 ? -(z.r + a) : z.r + a);
+    }
+    const double x = u * z.x[i];
+    if (z.f[i] + uniform(e) * (z.f[i+1] - z.f[i]) < ::exp(-0.5 * x * x)) return x;
+  }
+}
+
+// A standard exponential sample, given the first 64 random bits.
+template<typename Engine>
+double exponential(Engine& e, const ziggurat<256>& z, uint64_t bits)
+{
+  for (;; bits = e()) {
+    const int i = bits & 255;
+    const double u = (bits >> 11) * (1.0 / 9007199254740992.0);
+    if (u < z.ratio[i]) return u * z.x[i];
+    if (i == 0) return z.r - ::log(1 - uniform(e)); // memoryless tail
+    const double x = u * z.x[i];
+    if (z.f[i] + uniform(e) * (z.f[i+1] - z.f[i]) < ::exp(-x)) return x;
+  }
+}
+
+// Ziggurat fill: the fast path runs over blocks of random words without
+// branches, and only the ~1% of rejected points take the slow path.
+template<int N, typename Engine, typename OutputIterator, typename Slow>
+OutputIterator fill_ziggurat(Engine& e, const ziggurat<N>& z, bool symmetric, OutputIterator out, size_t count,
+                             double location, double scale, Slow slow)
+{
+  enum { B = 64 };
+  uint64_t bits[B];
+  double value[B];
+  bool inside[B];
+  while (count) {
+    const size_t n = std::min(count, (size_t) B);
+    for (size_t j = 0; j < n; ++j) bits[j] = e();
+    for (size_t j = 0; j < n; ++j) {
+      const int i = bits[j] & (N - 1);
+      const double u = (bits[j] >> 11) * (1.0 / 9007199254740992.0);
+      inside[j] = (u < z.ratio[i]);
+      value[j] = ((symmetric && (bits[j] & N)) ? -u : u) * z.x[i];
+    }
+    for (size_t j = 0; j < n; ++j) {
+      *out++ = location + scale * (inside[j] ? value[j] : slow(bits[j]));
+    }
+    count -= n;
+  }
+  return out;
+}
+
+// Constants of the PTRS Poisson sampler (Hormann, 1993) for mean >= 10.
+struct ptrs
+{
+  double mean, slam, loglam, a, b, invalpha, vr;
+
+  explicit ptrs(double m)
+    : mean(m), slam(::sqrt(m)), loglam(::log(m)), a(0), b(0.931 + 2.53 * slam), invalpha(0), vr(0)
+  {
+    a = -0.059 + 0.02483 * b;
+    invalpha = 1.1239 + 1.1328 / (b - 3.4);
+    vr = 0.9277 - 3.6224 / (b - 2);
+  }
+
+  template<typename Engine>
+  long operator()(Engine& e) const
+  {
+    for (;;) {
+      const double u = uniform(e) - 0.5, v = uniform(e), us = 0.5 - ::fabs(u);
+      const long k = (long) ::floor((2 * a / us + b) * u + mean + 0.43);
+      if (us >= 0.07 && v <= vr) return k;
+      if (k < 0 || (us < 0.013 && v > us)) continue;
+      if (::log(v) + ::log(invalpha) - ::log(a / (us * us) + b) <= -mean + k * loglam - ::lgamma(k + 1.0)) return k;
+    }
+  }
+};
+
+// Poisson by multiplication of uniforms, for small means.
+template<typename Engine>
+long poisson_product(Engine& e, double limit) // limit = exp(-mean)
+{
+  long k = 0;
+  for (double p = uniform(e); p > limit; p *= uniform(e)) ++k;
+  return k;
+}
+
+// Constants of the BTRS binomial sampler (Hormann, 1993) for n p >= 10 and
+// p <= 1/2.
+struct btrs
+{
+  long n;
+  double p, spq, a, b, c, vr, alpha, lpq, m, h;
+
+  btrs(long trials, double prob)
+    : n(trials), p(prob), spq(::sqrt(trials * prob * (1 - prob))), a(0), b(1.15 + 2.53 * spq),
+      c(trials * prob + 0.5), vr(0.92 - 4.2 / b), alpha((2.83 + 5.1 / b) * spq),
+      lpq(::log(prob / (1 - prob))), m(::floor((trials + 1) * prob)), h(0)
+  {
+    a = -0.0873 + 0.0248 * b + 0.01 * p;
+    h = ::lgamma(m + 1) + ::lgamma(n - m + 1);
+  }
+
+  template<typename Engine>
+  long operator()(Engine& e) const
+  {
+    for (;;) {
+      const double u = uniform(e) - 0.5, us = 0.5 - ::fabs(u);
+      double v = uniform(e);
+      const long k = (long) ::floor((2 * a / us + b) * u + c);
+      if (k < 0 || k > n) continue;
+      if (us >= 0.07 && v <= vr) return k;
+      v = ::log(v * alpha / (a / (us * us) + b));
+      if (v <= h - ::lgamma(k + 1.0) - ::lgamma(n - k + 1.0) + (k - m) * lpq) return k;
+    }
+  }
+};
+
+// Binomial by inversion (sequential search from 0), for n p < 10, p <= 1/2.
+template<typename Engine>
+long binomial_inversion(Engine& e, long n, double p, double qn) // qn = (1-p)^n
+{
+  const double s = p / (1 - p), a = (n + 1) * s;
+  for (;;) {
+    double u = uniform(e), r = qn;
+    for (long k = 0; k <= n; ++k) {
+      if (u <= r) return k;
+      u -= r;
+      r *= a / (k + 1) - s;
+    }
+  }
+}
+
+} // namespace detail
+
+// Normal distribution, by the ziggurat method.
+template<typename Engine>
+double normal(Engine& e, double mean = 0, double stddev = 1)
+{
+  return mean + stddev * detail::normal(e, detail::normal_ziggurat(), e());
+}
+
+// Exponential distribution of rate lambda, by the ziggurat method.
+template<typename Engine>
+double exponential(Engine& e, double lambda = 1)
+{
+  return detail::exponential(e, detail::exponential_ziggurat(), e()) / lambda;
+}
+
+// Poisson distribution: PTRS transformed rejection for means >= 10,
+// multiplication of uniforms below.
+template<typename Engine>
+long poisson(Engine& e, double mean)
+{
+  if (mean >= 10) return detail::ptrs(mean)(e);
+  return detail::poisson_product(e, ::exp(-mean));
+}
+
+// Binomial distribution: BTRS transformed rejection for n min(p, 1-p) >= 10,
+// inversion below.
+template<typename Engine>
+long binomial(Engine& e, long n, double p)
+{
+  if (p > 0.5) return n - binomial(e, n, 1 - p);
+  if (n * p >= 10) return detail::btrs(n, p)(e);
+  return detail::binomial_inversion(e, n, p, ::pow(1 - p, (double) n));
+}
+
+/// Bulk Functions ///
+
+// Each writes count samples to out and returns out advanced; the constants
+// of the distribution are computed once for all samples.
+
+template<typename Engine, typename OutputIterator>
+OutputIterator fill_normal(Engine& e, OutputIterator out, size_t count, double mean = 0, double stddev = 1)
+{
+  const detail::ziggurat<128>& z = detail::normal_ziggurat();
+  return detail::fill_ziggurat(e, z, true, out, count, mean, stddev,
+                               [&e, &z](uint64_t bits) { return detail::normal(e, z, bits); });
+}
+
+template<typename Engine, typename OutputIterator>
+OutputIterator fill_exponential(Engine& e, OutputIterator out, size_t count, double lambda = 1)
+{
+  const detail::ziggurat<256>& z = detail::exponential_ziggurat();
+  return detail::fill_ziggurat(e, z, false, out, count, 0, 1 / lambda,
+                               [&e, &z](uint64_t bits) { return detail::exponential(e, z, bits); });
+}
+
+template<typename Engine, typename OutputIterator>
+OutputIterator fill_poisson(Engine& e, OutputIterator out, size_t count, double mean)
+{
+  if (mean >= 10) {
+    const detail::ptrs sampler(mean);
+    for (size_t i = 0; i < count; ++i) *out++ = sampler(e);
+  } else {
+    const double limit = ::exp(-mean);
+    for (size_t i = 0; i < count; ++i) *out++ = detail::poisson_product(e, limit);
+  }
+  return out;
+}
+
+template<typename Engine, typename OutputIterator>
+OutputIterator fill_binomial(Engine& e, OutputIterator out, size_t count, long n, double p)
+{
+  const bool flip = (p > 0.5);
+  const double q = (flip ? 1 - p : p);
+  if (n * q >= 10) {
+    const detail::btrs sampler(n, q);
+    for (size_t i = 0; i < count; ++i) *out++ = (flip ? n - sampler(e) : sampler(e));
+  } else {
+    const double qn = ::pow(1 - q, (double) n);
+    for (size_t i = 0; i < count; ++i) {
+      const long k = detail::binomial_inversion(e, n, q, qn);
+      *out++ = (flip ? n - k : k);
+    }
+  }
+  return out;
+}
+
+/// Sampling ///
+
+namespace detail {
+
+// uniform in ]0, 1[, for logarithms
+template<typename Engine>
+double uniform_positive(Engine& e)
+{
+  return ((e() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Floyd's algorithm on a bitmap of n bits, for k a large part of n: writes
+// offset + the selected integers in increasing order.
+template<typename Engine, typename OutputIterator>
+OutputIterator sample_dense(Engine& e, uint64_t n, uint64_t k, uint64_t offset, OutputIterator out)
+{
+  std::vector<uint64_t> bits((n + 63) / 64);
+  for (uint64_t j = n - k; j < n; ++j) {
+    uint64_t x = uniform_integer(e, j + 1);
+    if (bits[x / 64] >> (x % 64) & 1) x = j;
+    bits[x / 64] |= (uint64_t) 1 << (x % 64);
+  }
+  for (size_t w = 0; w < bits.size(); ++w) {
+    for (uint64_t b = bits[w]; b; b &= b - 1) *out++ = offset + 64 * w + __builtin_ctzll(b);
+  }
+  return out;
+}
+
+} // namespace detail
+
+// Writes k distinct integers of [0, n[ chosen uniformly, in no particular
+// order, for k <= n (Floyd's algorithm: k draws, O(k) memory, or n bits when
+// k exceeds n / 16).
+template<typename Engine, typename OutputIterator>
+OutputIterator sample(Engine& e, uint64_t n, uint64_t k, OutputIterator out)
+{
+  if (k > n / 16) return detail::sample_dense(e, n, k, 0, out);
+  std::unordered_set<uint64_t> chosen(2 * k);
+  for (uint64_t j = n - k; j < n; ++j) {
+    const uint64_t t = uniform_integer(e, j + 1);
+    const uint64_t x = (chosen.insert(t).second ? t : j);
+    if (x == j) chosen.insert(j);
+    *out++ = x;
+  }
+  return out;
+}
+
+// Writes k distinct integers of [0, n[ chosen uniformly, in increasing order,
+// for k <= n (Vitter's Algorithm D: O(k) expected time, no extra memory). The
+// gap to the next selected integer is drawn by rejection from a continuous
+// approximation. Once k exceeds n / 13, the rest is drawn on a bitmap.
+template<typename Engine, typename OutputIterator>
+OutputIterator sample_sorted(Engine& e, uint64_t n, uint64_t k, OutputIterator out)
+{
+  enum { alpha = 13 };
+  if (!k) return out;
+  uint64_t current = 0;
+  double real_k = (double) k, real_n = (double) n, kinv = 1 / real_k;
+  double vprime = ::exp(::log(detail::uniform_positive(e)) * kinv);
+  uint64_t qu1 = n - k + 1;
+  double real_qu1 = real_n - real_k + 1;
+  uint64_t threshold = alpha * k;
+
+  while (k > 1 && threshold < n) {
+    const double kmin1inv = 1 / (real_k - 1);
+    double x;
+    uint64_t skip;
+    for (;;) {
+      // D2: a gap from the continuous approximation, below n - k + 1
+      for (;;) {
+        x = real_n * (1 - vprime);
+        skip = (uint64_t) x;
+        if (skip < qu1) break;
+        vprime = ::exp(::log(detail::uniform_positive(e)) * kinv);
+      }
+      // D3: quick acceptance
+      const double u = detail::uniform_positive(e);
+      const double y1 = ::exp(::log(u * real_n / real_qu1) * kmin1inv);
+      vprime = y1 * (1 - x / real_n) * (real_qu1 / (real_qu1 - skip));
+      if (vprime <= 1) break;
+      // D4: exact acceptance test
+      double y2 = 1, top = real_n - 1, bottom;
+      uint64_t limit;
+      if (k - 1 > skip) {
+        bottom = real_n - real_k;
+        limit = n - skip;
+      } else {
+        bottom = real_n - skip - 1;
+        limit = qu1;
+      }
+      for (uint64_t t = n - 1; t >= limit; --t) {
+        y2 = y2 * top / bottom;
+        --top;
+        --bottom;
+      }
+      if (real_n / (real_n - x) >= y1 * ::exp(::log(y2) * kmin1inv)) {
+        vprime = ::exp(::log(detail::uniform_positive(e)) * kmin1inv);
+        break;
+      }
+      vprime = ::exp(::log(detail::uniform_positive(e)) * kinv);
+    }
+    // D5: select current + skip
+    current += skip;
+    *out++ = current++;
+    n -= skip + 1;
+    real_n -= skip + 1;
+    --k;
+    --real_k;
+    kinv = kmin1inv;
+    qu1 -= skip;
+    real_qu1 -= skip;
+    threshold -= alpha;
+  }
+  if (k > 1) return detail::sample_dense(e, n, k, current, out);
+  *out++ = current + (uint64_t) (real_n * vprime);
+  return out;
+}
+
+// Reservoir sampling: keeps a uniform sample of k items of a single-pass
+// sequence in reservoir[0..k[ and returns the number kept, min(k, length).
+// Li's Algorithm L draws the number of items to skip between replacements,
+// so the engine is called O(k log(length / k)) times.
+template<typename Engine, typename InputIterator, typename RandomAccessIterator>
+size_t reservoir_sample(Engine& e, InputIterator first, InputIterator last, size_t k, RandomAccessIterator reservoir)
+{
+  size_t kept = 0;
+  for (; kept < k && first != last; ++first) reservoir[kept++] = *first;
+  if (kept < k || !k) return kept;
+
+  double w = ::exp(::log(detail::uniform_positive(e)) / k);
+  for (;;) {
+    for (uint64_t skip = (uint64_t) (::log(detail::uniform_positive(e)) / ::log1p(-w)); skip; --skip) {
+      if (first == last) return k;
+      ++first;
+    }
+    if (first == last) return k;
+    reservoir[uniform_integer(e, k)] = *first++;
+    w *= ::exp(::log(detail::uniform_positive(e)) / k);
+  }
+}
+
+// Random permutation of [first, last[ with several threads (Sanders, 1998):
+// each element is sent to a random bucket small enough to stay in cache,
+// then every bucket is shuffled on its own. Bucket numbers are drawn twice
+// from the same per-thread seeds (once to count, once to scatter) rather
+// than stored. The result depends on seed and threads only.
+template<typename RandomAccessIterator>
+void parallel_shuffle(RandomAccessIterator first, RandomAccessIterator last, uint64_t seed,
+                      unsigned threads = std::thread::hardware_concurrency())
+{
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+  enum { bucket_size = 1 << 15 };
+  const size_t n = last - first;
+  if (threads < 1) threads = 1;
+  if (n < 2 * bucket_size) {
+    xoshiro256 e(seed);
+    for (size_t i = n; i > 1; --i) std::iter_swap(first + (i - 1), first + uniform_integer(e, i));
+    return;
+  }
+
+  const size_t buckets = (n + bucket_size - 1) / bucket_size;
+  std::vector<std::vector<size_t> > offsets(threads, std::vector<size_t>(buckets + 1));
+  std::vector<value_type> scattered(n);
+
+  auto run = [threads](const std::function<void(unsigned)>& f) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.push_back(std::thread(f, t));
+    f(0);
+    for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+  };
+
+  // count the elements each thread sends to each bucket
+  run([&](unsigned t) {
+    xoshiro256 e(seed + t);
+    std::vector<size_t>& count = offsets[t];
+    for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; ++i) ++count[uniform_integer(e, buckets)];
+  });
+
+  // thread t writes its share of bucket b after those of threads 0..t-1
+  size_t start = 0;
+  for (size_t b = 0; b < buckets; ++b) {
+    for (unsigned t = 0; t < threads; ++t) {
+      const size_t c = offsets[t][b];
+      offsets[t][b] = start;
+      start += c;
+    }
+  }
+  std::vector<size_t> bucket_start(buckets + 1, n);
+  for (size_t b = 0; b < buckets; ++b) bucket_start[b] = offsets[0][b];
+
+  run([&](unsigned t) {
+    xoshiro256 e(seed + t);
+    std::vector<size_t>& next = offsets[t];
+    for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; ++i) {
+      scattered[next[uniform_integer(e, buckets)]++] = first[i];
+    }
+  });
+
+  // shuffle the buckets back in place, bucket b with its own seed
+  run([&](unsigned t) {
+    for (size_t b = t; b < buckets; b += threads) {
+      xoshiro256 e(seed ^ (0x9e3779b97f4a7c15ULL * (b + 1)));
+      const size_t lo = bucket_start[b], size = bucket_start[b+1] - lo;
+      RandomAccessIterator out = first + lo;
+      std::copy(scattered.begin() + lo, scattered.begin() + (lo + size), out);
+      for (size_t i = size; i > 1; --i) std::iter_swap(out + (i - 1), out + uniform_integer(e, i));
+    }
+  });
+}
+
 } // namespace random
 } // namespace pads
 
@@ -2,6 +2,10 @@
 #define _SLIDING_AVERAGE_H_
 
 #include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <type_traits>
 #include <vector>
 
 template<typename T, int N, class C = std::vector<T> >
@@ -47,4 +51,116 @@ public:
   }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Sliding Averages of Many Series
+//
+// One window of N samples per series ID in [0, size()[, all stored in three
+// arrays: the samples (series after series), the sums and a fill counter.
+// Beyond its N samples a series costs one T and one 1, 2 or 4-byte counter.
+// The counter c is the number of samples while the window fills up (c < N),
+// then cycles through [N, 2N[ so that the oldest sample is at c - N.
+
+template<typename T, int N>
+class sliding_average_table
+{
+public:
+  typedef T value_type;
+  typedef typename std::conditional<(2 * N <= 256), uint8_t,
+          typename std::conditional<(2 * N <= 65536), uint16_t, uint32_t>::type>::type counter_type;
+  enum { capacity = N };
+
+  // The samples are left uninitialized: a window is only read once full.
+  explicit sliding_average_table(size_t series = 0)
+    : samples(new T[series * N]), sums(series), counts(series)
+  {}
+
+  size_t size() const
+  {
+    return sums.size();
+  }
+
+  void resize(size_t series)
+  {
+    T* p = new T[series * N];
+    std::copy(samples.get(), samples.get() + std::min(series, sums.size()) * N, p);
+    samples.reset(p);
+    sums.resize(series);
+    counts.resize(series);
+  }
+
+  double add(size_t id, const T& t)
+  {
+    push(id, t);
+    return mean(id);
+  }
+
+  // Adds values[i] to the series ids[i], in order, for i in [0, count[.
+  // The updates are scattered over the table, so the lines of the series
+  // a few iterations ahead are prefetched.
+  void add(const size_t* ids, const T* values, size_t count)
+  {
+    enum { ahead = 8 };
+    for (size_t i = 0; i < count; ++i) {
+      if (i + ahead < count) {
+        const size_t next = ids[i + ahead];
+        __builtin_prefetch(&counts[next], 1);
+        __builtin_prefetch(&sums[next], 1);
+        __builtin_prefetch(&samples[next * N], 1);
+        if (N * sizeof(T) > 64) __builtin_prefetch(&samples[next * N + N - 1], 1);
+      }
+      push(ids[i], values[i]);
+    }
+  }
+
+  // Adds values[id] to every series.
+  void add(const T* values)
+  {
+    for (size_t id = 0; id < sums.size(); ++id) push(id, values[id]);
+  }
+
+  double mean(size_t id) const
+  {
+    return ((double) sums[id]) / std::min<size_t>(counts[id], N);
+  }
+
+  // Writes the mean of every series to out[0..size()[ in one pass over the
+  // sums and counters, which the compiler vectorizes (-O3).
+  void means(double* out) const
+  {
+    const T* sum = sums.data();
+    const counter_type* count = counts.data();
+    const size_t n = sums.size();
+    for (size_t id = 0; id < n; ++id) {
+      out[id] = ((double) sum[id]) / (count[id] < N ? count[id] : N);
+    }
+  }
+
+  void clear(size_t id)
+  {
+    sums[id] = 0;
+    counts[id] = 0;
+  }
+
+  void clear()
+  {
+    std::fill(sums.begin(), sums.end(), T(0));
+    std::fill(counts.begin(), counts.end(), 0);
+  }
+
+private:
+  std::unique_ptr<T[]> samples;
+  std::vector<T> sums;
+  std::vector<counter_type> counts;
+
+  void push(size_t id, const T& t)
+  {
+    const counter_type c = counts[id];
+    T& slot = samples[id * N + (c < N ? c : c - N)];
+    if (c >= N) sums[id] -= slot;
+    slot = t;
+    sums[id] += t;
+    counts[id] = (c + 1 == 2 * N ? N : c + 1);
+  }
+};
+
 #endif // _SLIDING_AVERAGE_H_
@@ -5,6 +5,10 @@
 #include <memory>
 #include <ostream>
 #include <stdexcept>
+#include <utility>
+#include <vector>
+#include "tree_image.hpp"
+#include "tree_stats.hpp"
 
 namespace pads {
 
@@ -40,6 +44,54 @@ public:
   }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Splaying Policies
+//
+// Select how lookups (contains, operator[], find_min, find_max) restructure the
+// tree; insert and remove always splay. A policy with always = 0 is asked after
+// a read-only search whether the path should be splayed: lookups it declines
+// do not write to the tree at all.
+
+// Top-down splaying on every lookup (the classic behavior).
+struct full_splaying
+{
+  enum { always = 1, semi = 0 };
+  bool should_splay(size_t, size_t) const { return true; }
+};
+
+// Top-down semi-splaying: on every pair of steps in the same direction the
+// grandparent is rotated once, which halves the depth of the access path
+// without bringing the accessed node to the root.
+struct semi_splaying
+{
+  enum { always = 1, semi = 1 };
+  bool should_splay(size_t, size_t) const { return true; }
+};
+
+// Splays with probability P percent.
+template<int P = 50>
+class random_splaying
+{
+  lcg rng;
+
+public:
+  enum { always = 0, semi = 0 };
+  bool should_splay(size_t, size_t) { return rng.random_integer() % 100 < P; }
+};
+
+// Splays only when the access path is longer than C * log2(size).
+template<int C = 2>
+struct depth_splaying
+{
+  enum { always = 0, semi = 0 };
+  bool should_splay(size_t depth, size_t size) const
+  {
+    size_t log = 1;
+    while (size >>= 1) ++log;
+    return depth > C * log;
+  }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Top-Down Splay Tree
 
@@ -64,17 +116,21 @@ struct node
 
 template<typename K, typename T,
          typename C = std::less<K>,
-         typename A = std::allocator<node<K, T> > >
-class splay_tree
+         typename A = std::allocator<node<K, T> >,
+         typename P = full_splaying,
+         typename S = no_tree_stats>
+class splay_tree : private P, private S
 {
 public:
   splay_tree()
+    : count(0)
   {
     reset_null_node();
     root = null_node;
   }
 
   splay_tree(const splay_tree& rhs)
+    : count(0)
   {
     reset_null_node();
     root = null_node;
@@ -85,7 +141,8 @@ public:
   {
     if (this != &rhs) {
       clear();
-      root = clone(rhs.root);
+      root = clone(rhs.root, rhs.null_node);
+      count = rhs.count;
     }
     return *this;
   }
@@ -102,51 +159,64 @@ public:
     return is_null(root);
   }
 
+  size_t size() const
+  {
+    return count;
+  }
+
   const T& find_min()
   {
     if (empty()) throw std::underflow_error("empty tree");
+    size_t depth = 1;
     node_type* n = root;
-    while (!is_null(n->left)) n = n->left;
-    splay(n->key, root);
+    for (; !is_null(n->left); ++depth) n = n->left;
+    access(n->key, depth);
     return n->value;
   }
 
   const T& find_max()
   {
     if (empty()) throw std::underflow_error("empty tree");
+    size_t depth = 1;
     node_type* n = root;
-    while (!is_null(n->right)) n = n->right;
-    splay(n->key, root);
+    for (; !is_null(n->right); ++depth) n = n->right;
+    access(n->key, depth);
     return n->value;
   }
 
   bool contains(const K& k)
   {
-    if (empty()) return false;
-    splay(k, root);
-    return root->key == k;
+    return find(k) != 0;
   }
 
   T& operator[](const K& k)
   {
-    if (!contains(k)) insert(k, T());
-    return root->value;
+    node_type* n = find(k);
+    if (!n) {
+      insert(k, T());
+      n = root;
+    }
+    return n->value;
   }
 
   bool insert(const K& k, const T& t)
   {
     if (is_null(root)) {
+      S::on_operation(op_insert, 0);
       root = get_new_node(k, t);
+      ++count;
     } else {
-      splay(k, root);
+      S::on_operation(op_insert, splay(k, root));
       if (comp(k, root->key)) {
         node_type* n = get_new_node(k, t, root->left, root);
         root->left = null_node;
         root = n;
+        ++count;
       } else if (comp(root->key, k)) {
         node_type* n = get_new_node(k, t, root, root->right);
         root->right = null_node;
         root = n;
+        ++count;
       } else {
         root->value = t;
         return false;
@@ -157,19 +227,25 @@ public:
 
   void remove(const K& k)
   {
-    splay(k, root);
-    if (root->key != k) return;
+    size_t path = splay(k, root);
+    if (root->key != k) {
+      S::on_operation(op_remove, path);
+      return;
+    }
 
     node_type* new_root;
     if (is_null(root->left)) {
       new_root = root->right;
     } else {
       new_root = root->left;
-      splay(k, new_root);
+      path += splay(k, new_root);
       new_root->right = root->right;
     }
+    S::on_operation(op_remove, path);
+    S::on_deallocation();
     node_alloc.deallocate(root, 1);
     root = new_root;
+    --count;
   }
 
   void clear()
@@ -180,6 +256,196 @@ public:
     }
   }
 
+public:
+  /// Batch Operations ///
+
+  // Looks up the sorted keys [first, last[ and writes for each of them a
+  // pointer to its value (or 0) to out. The keys are searched from the
+  // previous one (finger search) and the tree is not restructured.
+  template<typename InputIterator, typename OutputIterator>
+  OutputIterator lookup_sorted(InputIterator first, InputIterator last, OutputIterator out)
+  {
+    // search path: each node with the nearest ancestor we went left from,
+    // whose key bounds its subtree (0 for unbounded)
+    std::vector<std::pair<node_type*, node_type*> > path;
+    if (!empty()) path.push_back(std::make_pair(root, (node_type*) 0));
+
+    for (; first != last; ++first) {
+      const K& k = *first;
+      size_t length = 0;
+      while (path.size() > 1 && path.back().second && !comp(k, path.back().second->key)) {
+        path.pop_back();
+      }
+
+      node_type* found = 0;
+      while (!path.empty()) {
+        node_type* n = path.back().first;
+        node_type* bound = path.back().second;
+        ++length;
+        if (comp(k, n->key)) {
+          if (is_null(n->left)) break;
+          path.push_back(std::make_pair(n->left, n));
+        } else if (comp(n->key, k)) {
+          if (is_null(n->right)) break;
+          path.push_back(std::make_pair(n->right, bound));
+        } else {
+          found = n;
+          break;
+        }
+      }
+      S::on_operation(op_find, length);
+      *out++ = (found ? &found->value : 0);
+    }
+    return out;
+  }
+
+  // Same as lookup_sorted() for unsorted keys: the keys are searched by
+  // groups whose descents are interleaved, with the next node of every
+  // search prefetched while the others are compared.
+  template<typename ForwardIterator, typename OutputIterator>
+  OutputIterator lookup(ForwardIterator first, ForwardIterator last, OutputIterator out)
+  {
+    enum { G = 8 };
+    const K* keys[G];
+    node_type* nodes[G]; // null_node once the search failed
+    size_t lengths[G];
+    bool done[G];
+
+    while (first != last) {
+      int g = 0;
+      for (; g < G && first != last; ++g, ++first) {
+        keys[g] = &*first;
+        nodes[g] = root;
+        lengths[g] = 0;
+        done[g] = empty();
+      }
+
+      for (int active = g; active; ) {
+        active = 0;
+        for (int i = 0; i < g; ++i) {
+          if (done[i]) continue;
+          node_type* n = nodes[i];
+          ++lengths[i];
+          if (comp(*keys[i], n->key)) {
+            n = n->left;
+          } else if (comp(n->key, *keys[i])) {
+            n = n->right;
+          } else {
+            done[i] = true;
+            S::on_operation(op_find, lengths[i]);
+            continue;
+          }
+          nodes[i] = n;
+          if (is_null(n)) {
+            done[i] = true;
+            S::on_operation(op_find, lengths[i]);
+          } else {
+            __builtin_prefetch(n);
+            ++active;
+          }
+        }
+      }
+
+      for (int i = 0; i < g; ++i) {
+        *out++ = (is_null(nodes[i]) ? 0 : &nodes[i]->value);
+      }
+    }
+    return out;
+  }
+
+  // Inserts (or updates) the pairs [first, last[ sorted by key. Batches that
+  // are large compared to the tree are merged with its nodes and the result
+  // is rebuilt balanced in O(n + m); smaller ones are splayed in one after
+  // the other, in O(m log(n/m)) amortized by the dynamic finger property.
+  template<typename InputIterator>
+  void insert_sorted(InputIterator first, InputIterator last)
+  {
+    std::vector<std::pair<K, T> > batch(first, last);
+    const size_t m = batch.size();
+    size_t log = 1;
+    for (size_t n = count; n >>= 1; ) ++log;
+
+    if (m * log < count) {
+      for (size_t i = 0; i < m; ++i) insert(batch[i].first, batch[i].second);
+      return;
+    }
+
+    std::vector<node_type*> nodes;
+    flatten(root, nodes);
+    std::vector<node_type*> merged;
+    merged.reserve(nodes.size() + m);
+    size_t i = 0, j = 0;
+    while (j < m) {
+      if (i < nodes.size() && comp(nodes[i]->key, batch[j].first)) {
+        merged.push_back(nodes[i++]);
+      } else {
+        // later duplicates of the batch win, as with insert()
+        while (j + 1 < m && !comp(batch[j].first, batch[j+1].first)) ++j;
+        if (i < nodes.size() && !comp(batch[j].first, nodes[i]->key)) {
+          nodes[i]->value = batch[j].second;
+          merged.push_back(nodes[i++]);
+        } else {
+          merged.push_back(get_new_node(batch[j].first, batch[j].second));
+          ++count;
+        }
+        ++j;
+      }
+    }
+    merged.insert(merged.end(), nodes.begin() + i, nodes.end());
+    root = build(merged, 0, merged.size());
+  }
+
+public:
+  /// Serialization ///
+
+  // Writes the pairs to os as a tree image (see tree_image.hpp), in key
+  // order; K and T must be trivially copyable. The tree is not restructured.
+  void save(std::ostream& os) const
+  {
+    image_writer<K, T> out(os, count);
+    std::vector<node_type*> stack;
+    for (node_type* n = root; !is_null(n) || !stack.empty(); ) {
+      if (!is_null(n)) {
+        stack.push_back(n);
+        n = n->left;
+      } else {
+        n = stack.back();
+        stack.pop_back();
+        typename image_writer<K, T>::record& r = out.next();
+        r.key = n->key;
+        r.value = n->value;
+        n = n->right;
+      }
+    }
+    out.finish();
+  }
+
+  // Replaces the contents with the image read from is, linked balanced in
+  // O(n). Throws std::runtime_error on a malformed or unsorted image, in
+  // which case the tree is left unchanged.
+  void load(std::istream& is)
+  {
+    image_reader<K, T> in(is);
+    std::vector<node_type*> nodes;
+    nodes.reserve(in.size());
+    try {
+      for (uint64_t i = 0; i < in.size(); ++i) {
+        const typename image_reader<K, T>::record& r = in.next();
+        if (i && !comp(nodes.back()->key, r.key)) throw std::runtime_error("unsorted tree image");
+        nodes.push_back(get_new_node(r.key, r.value));
+      }
+    } catch (...) {
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        S::on_deallocation();
+        node_alloc.deallocate(nodes[i], 1);
+      }
+      throw;
+    }
+    clear();
+    root = build(nodes, 0, nodes.size());
+    count = nodes.size();
+  }
+
   void print(std::ostream& os) const
   {
     os << "digraph G {\n";
@@ -187,6 +453,11 @@ public:
     os << '}';
   }
 
+  const S& statistics() const
+  {
+    return *this;
+  }
+
 private:
   typedef node<K, T> node_type;
 
@@ -196,6 +467,7 @@ private:
 
   node_type* null_node;
   node_type* root;
+  size_t count;
 
   bool is_null(const node_type* const n) const
   {
@@ -211,12 +483,94 @@ private:
 
   node_type* get_new_node(const K& k, const T& t, node_type* l = 0, node_type* r = 0)
   {
+    S::on_allocation();
     node_type* n = node_alloc.allocate(1);
     node_alloc.construct(n, node_type(k, t, (l?l:null_node), (r?r:null_node)));
     return n;
   }
 
 private:
+  // Returns the node holding k (or 0) after restructuring it according to P.
+  node_type* find(const K& k)
+  {
+    if (empty()) return 0;
+
+    size_t path = 0;
+    node_type* n;
+    if (P::semi) {
+      n = semi_splay(k, path);
+    } else if (P::always) {
+      path = splay(k, root);
+      n = (root->key == k ? root : 0);
+    } else {
+      n = lookup(k, path);
+      if (n && P::should_splay(path, count)) path += splay(k, root);
+    }
+    S::on_operation(op_find, path);
+    return n;
+  }
+
+  // Restructures the path to k, already found at the given depth.
+  void access(const K& k, size_t depth)
+  {
+    if (P::semi) {
+      size_t path = 0;
+      semi_splay(k, path);
+      S::on_operation(op_find, path);
+    } else if (P::always) {
+      S::on_operation(op_find, splay(k, root));
+    } else if (P::should_splay(depth, count)) {
+      S::on_operation(op_find, depth + splay(k, root));
+    } else {
+      S::on_operation(op_find, depth);
+    }
+  }
+
+  // Appends the nodes of the subtree n in order.
+  void flatten(node_type* n, std::vector<node_type*>& nodes) const
+  {
+    std::vector<node_type*> stack;
+    while (!is_null(n) || !stack.empty()) {
+      if (!is_null(n)) {
+        stack.push_back(n);
+        n = n->left;
+      } else {
+        n = stack.back();
+        stack.pop_back();
+        nodes.push_back(n);
+        n = n->right;
+      }
+    }
+  }
+
+  // Links the ordered nodes [first, last[ into a balanced subtree.
+  node_type* build(const std::vector<node_type*>& nodes, size_t first, size_t last)
+  {
+    if (first == last) return null_node;
+    const size_t mid = first + (last - first) / 2;
+    node_type* n = nodes[mid];
+    n->left = build(nodes, first, mid);
+    n->right = build(nodes, mid + 1, last);
+    return n;
+  }
+
+  // Read-only search.
+  node_type* lookup(const K& k, size_t& path) const
+  {
+    node_type* n = root;
+    while (!is_null(n)) {
+      ++path;
+      if (comp(k, n->key)) {
+        n = n->left;
+      } else if (comp(n->key, k)) {
+        n = n->right;
+      } else {
+        return n;
+      }
+    }
+    return 0;
+  }
+
   void print(std::ostream& os, node_type* n) const
   {
     if (!is_null(n)) {
@@ -232,18 +586,15 @@ private:
     }
   }
 
-  node_type* clone(node_type* n) const
+  node_type* clone(const node_type* n, const node_type* rhs_null_node)
   {
-    if (n == n->left) { // cannot test against null_node...
-      return null_node;
-    } else {
-      node_type* n = get_new_node(n->key, n->value, clone(n->left), clone(n->right));
-      return n;
-    }
+    if (n == rhs_null_node) return null_node;
+    return get_new_node(n->key, n->value, clone(n->left, rhs_null_node), clone(n->right, rhs_null_node));
   }
 
   void left_rotation(node_type*& n)
   {
+    S::on_rotation();
     node_type* k = n->left;
     n->left = k->right;
     k->right = n;
@@ -252,14 +603,51 @@ private:
 
   void right_rotation(node_type*& n)
   {
+    S::on_rotation();
     node_type* k = n->right;
     n->right = k->left;
     k->left = n;
     n = k;
   }
 
-  void splay(const K& k, node_type*& n)
+  // Returns the node holding k (or 0); path is incremented by the number of
+  // visited nodes.
+  node_type* semi_splay(const K& k, size_t& path)
+  {
+    node_type** link = &root;
+    for (;;) {
+      node_type* n = *link;
+      if (is_null(n)) return 0;
+      ++path;
+      if (comp(k, n->key)) {
+        node_type* l = n->left;
+        if (!is_null(l) && comp(k, l->key)) {
+          // zig-zig: l replaces n, continue below l
+          left_rotation(*link);
+          link = &l->left;
+          ++path;
+        } else {
+          link = &n->left;
+        }
+      } else if (comp(n->key, k)) {
+        node_type* r = n->right;
+        if (!is_null(r) && comp(r->key, k)) {
+          right_rotation(*link);
+          link = &r->right;
+          ++path;
+        } else {
+          link = &n->right;
+        }
+      } else {
+        return n;
+      }
+    }
+  }
+
+  // Returns the length of the splayed path.
+  size_t splay(const K& k, node_type*& n)
   {
+    size_t path = 1;
     node_type* leftTreeMax;
     node_type* rightTreeMin;
     node_type header;
@@ -271,14 +659,20 @@ private:
 
     for (;;) {
       if (comp(k, n->key)) {
-        if (comp(k, n->left->key)) left_rotation(n);
+        if (comp(k, n->left->key)) {
+          left_rotation(n);
+          ++path;
+        }
         if (is_null(n->left)) break;
         // link right
         rightTreeMin->left = n;
         rightTreeMin = n;
         n = n->left;
       } else if (comp(n->key, k)) {
-        if (comp(n->right->key, k)) right_rotation(n);
+        if (comp(n->right->key, k)) {
+          right_rotation(n);
+          ++path;
+        }
         if (is_null(n->right)) break;
         // link left
         leftTreeMax->right = n;
@@ -287,18 +681,20 @@ private:
       } else {
         break;
       }
+      ++path;
     }
 
     leftTreeMax->right = n->left;
     rightTreeMin->left = n->right;
     n->left = header.right;
     n->right = header.left;
+    return path;
   }
 };
 
 } // namespace pads
 
-template<typename K, typename T, typename C, typename A>
-std::ostream& operator<<(std::ostream& os, pads::splay_tree<K, T, C, A>& st) { st.print(os); return os; }
+template<typename K, typename T, typename C, typename A, typename P, typename S>
+std::ostream& operator<<(std::ostream& os, pads::splay_tree<K, T, C, A, P, S>& st) { st.print(os); return os; }
 
 #endif // _SPLAY_TREE_HPP_
@@ -0,0 +1,97 @@
+#ifndef _PADS_STATIC_PRIMES_H_
+#define _PADS_STATIC_PRIMES_H_
+
+#include <array>
+#include <cstddef>
+#include "integer.hpp"
+
+namespace pads {
+namespace math {
+
+////////////////////////////////////////////////////////////////////////////////
+// Compile-Time Primes (C++17)
+//
+// Everything here is constexpr, e.g. to size hash tables or build wheels
+// without any runtime cost:
+//   static_assert(is_prime(1000003), "");
+//   std::array<integer, 25> p = prime_table<25>();
+//   enum { buckets = next_prime_v<1000> };
+
+// Deterministic Miller-Rabin for all 64-bit n (first 12 primes as bases).
+constexpr bool is_prime(integer n)
+{
+  constexpr integer bases[12] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+  if (n < 2) return false;
+  for (integer p : bases) {
+    if (n % p == 0) return n == p;
+  }
+
+  integer u = n - 1;
+  int t = 0;
+  while (even(u)) {
+    u >>= 1;
+    ++t;
+  }
+  for (integer a : bases) {
+    integer x = modexp(a, u, n);
+    if (x == 1 || x == n - 1) continue;
+    int i = 1;
+    for (; i < t; ++i) {
+      x = mulmod(x, x, n);
+      if (x == n - 1) break;
+    }
+    if (i == t) return false;
+  }
+  return true;
+}
+
+// Smallest prime > n.
+constexpr integer next_prime(integer n)
+{
+  if (n < 2) return 2;
+  n += (odd(n) ? 2 : 1);
+  while (!is_prime(n)) n += 2;
+  return n;
+}
+
+// Largest prime < n, 0 if none.
+constexpr integer prev_prime(integer n)
+{
+  if (n <= 2) return 0;
+  if (n == 3) return 2;
+  n -= (odd(n) ? 2 : 1);
+  while (!is_prime(n)) n -= 2;
+  return n;
+}
+
+// sieve_table<N>()[i] is whether i is prime, for i < N.
+template<size_t N>
+constexpr std::array<bool, N> sieve_table()
+{
+  std::array<bool, N> t{};
+  for (size_t i = 2; i < N; ++i) t[i] = true;
+  for (size_t i = 2; i * i < N; ++i) {
+    if (!t[i]) continue;
+    for (size_t j = i * i; j < N; j += i) t[j] = false;
+  }
+  return t;
+}
+
+// The first N primes.
+template<size_t N>
+constexpr std::array<integer, N> prime_table()
+{
+  std::array<integer, N> p{};
+  integer n = 1;
+  for (size_t i = 0; i < N; ++i) p[i] = n = next_prime(n);
+  return p;
+}
+
+template<integer N> constexpr bool is_prime_v = is_prime(N);
+template<integer N> constexpr integer next_prime_v = next_prime(N);
+template<integer N> constexpr integer prev_prime_v = prev_prime(N);
+
+} // namespace math
+} // namespace pads
+
+#endif // _PADS_STATIC_PRIMES_H_
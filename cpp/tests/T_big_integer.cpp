@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+#include "big_integer.hpp"
+#include "primes.hpp"
+
+using pads::math::big_integer;
+
+big_integer random_big(size_t bits)
+{
+  big_integer n = 0;
+  while (n.bits() < bits) n = (n << 31) + big_integer(::lrand48());
+  return n >> (n.bits() - bits);
+}
+
+// schoolbook product, to check Karatsuba against
+big_integer basecase_product(const big_integer& a, const big_integer& b)
+{
+  std::vector<big_integer::limb> r(a.size() + b.size());
+  pads::math::detail::mul_basecase(&r[0], a.data(), a.size(), b.data(), b.size());
+  big_integer x = 0;
+  for (size_t i = r.size(); i--; ) x = (x << 64) + (big_integer(r[i] >> 32) << 32) + big_integer(r[i] & 0xffffffff);
+  return x;
+}
+
+long elapsed_us(const timeval& t0, const timeval& t)
+{
+  return 1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec);
+}
+
+int main()
+{
+  ::srand48(36);
+  int errors = 0;
+
+  // conversions and arithmetic identities
+  const big_integer f("-123456789012345678901234567890123456789");
+  errors += (f.to_string() != "-123456789012345678901234567890123456789");
+  errors += (big_integer("0x1fffffffffffffffffffffffffffffff") != (big_integer(1) << 125) - 1);
+  errors += (big_integer(-7) / 2 != -3 || big_integer(-7) % 2 != -1);
+  for (int i = 0; i < 100; ++i) {
+    const big_integer a = random_big(64 + 37 * i), b = random_big(1 + 23 * i) + 1;
+    errors += (a / b * b + a % b != a || a % b >= b);
+    errors += (a * b != basecase_product(a, b));
+    errors += (pads::math::gcd(a * b, b * 6) % b != 0);
+  }
+
+  // Fermat and Miller-Rabin on Mersenne numbers: 2^521-1 and 2^607-1 are prime
+  const big_integer m521 = (big_integer(1) << 521) - 1, m607 = (big_integer(1) << 607) - 1;
+  errors += (pads::math::modexp(big_integer(3), m521 - 1, m521) != 1);
+  errors += !pads::math::is_probable_prime(m607, 4) || pads::math::is_probable_prime(m607 * m521, 4);
+  errors += (pads::math::modinv(big_integer(3), m521) * 3 % m521 != 1);
+  errors += (pads::math::next_probable_prime(big_integer(1000000000)) != 1000000007);
+  errors += (pads::math::is_probable_prime(pads::math::integer(1000000007)) != 1);
+  if (errors) std::cout << "oops! " << errors << " errors" << std::endl;
+
+  static const size_t sizes[3] = { 256, 1024, 4096 };
+  for (int k = 0; k < 3; ++k) {
+    const size_t bits = sizes[k];
+    const int reps = (int) (4096 / bits) * (4096 / bits);
+    const big_integer a = random_big(bits), b = random_big(bits), n = (random_big(bits) >> 1 << 1) + 1;
+    const big_integer ab = a * b;
+    big_integer x = 0;
+    timeval t0, t;
+
+    std::cout << bits << " bits :";
+    gettimeofday(&t0, 0);
+    for (int i = 0; i < 100 * reps; ++i) x = a * b;
+    gettimeofday(&t, 0); std::cout << " mul " << elapsed_us(t0, t) * 10 / reps << " ns"; t0 = t;
+    std::vector<big_integer::limb> r(a.size() + b.size());
+    for (int i = 0; i < 100 * reps; ++i) pads::math::detail::mul_basecase(&r[0], a.data(), a.size(), b.data(), b.size());
+    gettimeofday(&t, 0); std::cout << " (schoolbook " << elapsed_us(t0, t) * 10 / reps << " ns)"; t0 = t;
+    for (int i = 0; i < 100 * reps; ++i) x = ab % n;
+    gettimeofday(&t, 0); std::cout << " / mod " << elapsed_us(t0, t) * 10 / reps << " ns"; t0 = t;
+    for (int i = 0; i < reps; ++i) x = pads::math::gcd(a, b);
+    gettimeofday(&t, 0); std::cout << " / gcd " << elapsed_us(t0, t) / reps << " us"; t0 = t;
+    x = pads::math::modexp(a, b, n);
+    gettimeofday(&t, 0); std::cout << " / modexp " << elapsed_us(t0, t) << " us"; t0 = t;
+    x = pads::math::modexp(a, b, n + 1);
+    gettimeofday(&t, 0); std::cout << " (even modulus " << elapsed_us(t0, t) << " us)" << std::endl;
+  }
+
+  return 0;
+}
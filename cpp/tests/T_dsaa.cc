@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <cstdlib>
 #include <ctime>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <limits>
 #include <map>
@@ -22,18 +24,37 @@ int main()
   std::random_shuffle(v.begin(), v.end());
   timeval t0, t;
 
-#if 0
-  std::cout << "dsaa::DS : ";
-  dsaa::DSL<int> dsl(std::numeric_limits<int>::max());
-  gettimeofday(&t0, 0);
-  for (int i = 0; i < 100000; ++i) {
-    dsl.insert(i);
-  }
-  gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us / "; t0 = t;
-  for (int i = 0; i < 100000; ++i) {
-    dsl.contains(i);
+#if 1
+  {
+    std::cout << "dsaa::DSL : ";
+    dsaa::DSL<int> dsl(std::numeric_limits<int>::max());
+    gettimeofday(&t0, 0);
+    for (int i = 0; i < 1000000; ++i) {
+      dsl.insert(i);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us / "; t0 = t;
+    for (int i = 0; i < 1000000; ++i) {
+      dsl.contains(i);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl;
+
+    std::cout << "dsaa::DSL (build) : ";
+    std::vector<int> sorted(1000000);
+    for (int i = 0; i < 1000000; ++i) {
+      sorted[i] = i;
+    }
+    gettimeofday(&t0, 0);
+    dsaa::DSL<int> built(std::numeric_limits<int>::max(), sorted.begin(), sorted.end());
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us / "; t0 = t;
+    for (int i = 0; i < 1000000; ++i) {
+      built.contains(i);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us / "; t0 = t;
+    for (int i = 0; i < 1000000; i += 2) {
+      built.remove(i);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us (remove)" << std::endl;
   }
-  gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl;
 #endif
 
 #if 0
@@ -64,7 +85,42 @@ int main()
 #endif
 
 #if 1
-  dsaa::splay_tree<int> st;
+  {
+    std::cout << "dsaa::BST (image) : ";
+    const char* path = "/tmp/T_dsaa.image";
+    dsaa::BST<int> bst;
+    for (int i = 0; i < 1000000; ++i) {
+      bst.insert(r.random_integer());
+    }
+    gettimeofday(&t0, 0);
+    {
+      std::ofstream os(path, std::ios::binary);
+      bst.save(os);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us (save) / "; t0 = t;
+    dsaa::BST<int> loaded;
+    {
+      std::ifstream is(path, std::ios::binary);
+      loaded.load(is);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us (load) / "; t0 = t;
+    int found = 0;
+    for (int i = 0; i < 1000000; ++i) {
+      found += loaded.contains(i);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us / "; t0 = t;
+    const pads::tree_image<int> image(path);
+    for (int i = 0; i < 1000000; ++i) {
+      found -= image.contains(i);
+    }
+    gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us (mapped)" << std::endl;
+    if (found || loaded.size() != bst.size() || image.size() != bst.size()) std::cout << "oops!" << std::endl;
+    std::remove(path);
+  }
+#endif
+
+#if 1
+  dsaa::splay_tree<int, std::less<int>, std::allocator<int>, pads::tree_stats> st;
   st.insert(1);
   st.insert(2);
   st.insert(3);
@@ -75,6 +131,7 @@ int main()
   st.insert(8);
   st.contains(4);
   std::cout << st << std::endl;
+  std::cout << st.statistics() << std::endl;
 #endif
 
 #if 0
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <sys/time.h>
+#include "heaps.hpp"
+#include "splay_tree.hpp"
+
+typedef unsigned long long key;
+
+const int N = 1 << 20; // pairs of the hold benchmark
+const int V = 1 << 17; // vertices of the shortest-path benchmark
+
+long elapsed_ms(const timeval& t0, const timeval& t)
+{
+  return 1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000;
+}
+
+// Hold model of a timer queue: pops the earliest deadline and pushes a later
+// one, with a steady population of N. Returns the sum of the popped keys.
+template<typename Q>
+key hold(Q& q, const std::vector<key>& delays)
+{
+  key sum = 0;
+  for (int i = 0; i < N; ++i) q.push(delays[i]);
+  for (size_t i = N; i < delays.size(); ++i) {
+    const key k = q.top();
+    q.pop();
+    sum += k;
+    q.push(k + delays[i]);
+  }
+  while (!q.empty()) {
+    sum += q.top();
+    q.pop();
+  }
+  return sum;
+}
+
+// adapters to the interface of hold()
+struct std_queue : std::priority_queue<key, std::vector<key>, std::greater<key> > {};
+
+// keys made unique by a sequence number in their low bits
+struct splay_queue
+{
+  pads::splay_tree<key, key> tree;
+  key seq;
+  splay_queue() : seq(0) {}
+  bool empty() const { return tree.empty(); }
+  key top() { return tree.find_min() >> 20; }
+  void pop() { tree.remove(tree.find_min()); }
+  void push(key k) { const key u = k << 20 | (seq++ & 0xfffff); tree.insert(u, u); }
+};
+
+struct pairing_queue
+{
+  pads::pairing_heap<key, char> heap;
+  bool empty() const { return heap.empty(); }
+  key top() const { return heap.top_key(); }
+  void pop() { heap.pop(); }
+  void push(key k) { heap.push(k, 0); }
+};
+
+struct radix_queue
+{
+  pads::radix_heap<key, char> heap;
+  bool empty() const { return heap.empty(); }
+  key top() { return heap.top_key(); }
+  void pop() { heap.pop(); }
+  void push(key k) { heap.push(k, 0); }
+};
+
+struct graph
+{
+  std::vector<int> first, to; // edges of u: to[first[u]] ... to[first[u+1]-1]
+  std::vector<key> weight;
+};
+
+graph random_graph(pads::lcg& r, int n, int degree)
+{
+  graph g;
+  for (int u = 0; u < n; ++u) {
+    g.first.push_back(g.to.size());
+    for (int d = 0; d < degree; ++d) {
+      g.to.push_back(r.random_integer(0, n - 1));
+      g.weight.push_back(r.random_integer(1, 1000));
+    }
+  }
+  g.first.push_back(g.to.size());
+  return g;
+}
+
+// Dijkstra with decrease-key
+std::vector<key> pairing_dijkstra(const graph& g)
+{
+  const int n = g.first.size() - 1;
+  std::vector<key> dist(n, ~0ULL);
+  typedef pads::pairing_heap<key, int> heap_type;
+  std::vector<heap_type::handle> handles(n);
+  heap_type heap;
+  dist[0] = 0;
+  handles[0] = heap.push(0, 0);
+  while (!heap.empty()) {
+    const int u = heap.top();
+    heap.pop();
+    handles[u] = 0;
+    for (int e = g.first[u]; e < g.first[u+1]; ++e) {
+      const int v = g.to[e];
+      const key d = dist[u] + g.weight[e];
+      if (d >= dist[v]) continue;
+      if (handles[v]) {
+        heap.decrease_key(handles[v], d);
+      } else if (dist[v] == ~0ULL) {
+        handles[v] = heap.push(d, v);
+      }
+      dist[v] = d;
+    }
+  }
+  return dist;
+}
+
+// Dijkstra with lazy deletion: stale pairs are skipped when popped
+template<typename Q>
+std::vector<key> lazy_dijkstra(const graph& g, Q& q)
+{
+  const int n = g.first.size() - 1;
+  std::vector<key> dist(n, ~0ULL);
+  dist[0] = 0;
+  q.push(std::make_pair(key(0), 0));
+  while (!q.empty()) {
+    const std::pair<key, int> p = q.top();
+    q.pop();
+    const int u = p.second;
+    if (p.first != dist[u]) continue;
+    for (int e = g.first[u]; e < g.first[u+1]; ++e) {
+      const int v = g.to[e];
+      const key d = dist[u] + g.weight[e];
+      if (d < dist[v]) {
+        dist[v] = d;
+        q.push(std::make_pair(d, v));
+      }
+    }
+  }
+  return dist;
+}
+
+typedef std::pair<key, int> item;
+
+struct radix_items
+{
+  pads::radix_heap<key, int> heap;
+  bool empty() const { return heap.empty(); }
+  item top() { return item(heap.top_key(), heap.top()); }
+  void pop() { heap.pop(); }
+  void push(const item& i) { heap.push(i.first, i.second); }
+};
+
+int main()
+{
+  pads::lcg r(44);
+  int errors = 0;
+
+  // checks against std::priority_queue, with decrease_key, erase and meld
+  {
+    pads::pairing_heap<key, int> a, b;
+    std::vector<pads::pairing_heap<key, int>::handle> handles;
+    std::priority_queue<key, std::vector<key>, std::greater<key> > reference;
+    for (int i = 0; i < 10000; ++i) handles.push_back((i & 1 ? a : b).push(r.random_integer(0, 1 << 30), i));
+    for (int i = 0; i < 10000; i += 3) {
+      pads::pairing_heap<key, int>& h = (i & 1 ? a : b);
+      h.decrease_key(handles[i], h.key(handles[i]) / 2);
+    }
+    for (int i = 1; i < 10000; i += 7) a.erase(handles[i]);
+    a.meld(b);
+    for (int i = 0; i < 10000; ++i) {
+      if (i % 7 != 1 || !(i & 1)) reference.push(a.key(handles[i]));
+    }
+    errors += (a.size() != reference.size() || !b.empty());
+    for (; !a.empty(); a.pop(), reference.pop()) errors += (a.top_key() != reference.top());
+
+    pads::radix_heap<unsigned, int> rh;
+    pads::d_ary_heap<key> dh;
+    std::vector<key> keys;
+    for (int i = 0; i < 100000; ++i) keys.push_back(r.random_integer(0, 1000000));
+    for (int i = 0; i < 100000; ++i) {
+      rh.push(keys[i], i);
+      dh.push(keys[i]);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (int i = 0; i < 100000; ++i) {
+      errors += (rh.top_key() != keys[i]) + (dh.top() != keys[i]);
+      rh.pop();
+      dh.pop();
+    }
+  }
+
+  std::vector<key> delays(3 * N);
+  for (size_t i = 0; i < delays.size(); ++i) delays[i] = r.random_integer(1, 1 << 20);
+  timeval t0, t;
+  key sums[5];
+
+  std::cout << "hold x " << 2 * N << " : priority_queue ";
+  gettimeofday(&t0, 0);
+  { std_queue q; sums[0] = hold(q, delays); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms / splay_tree "; t0 = t;
+  { splay_queue q; sums[1] = hold(q, delays); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms / pairing_heap "; t0 = t;
+  { pairing_queue q; sums[2] = hold(q, delays); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms / radix_heap "; t0 = t;
+  { radix_queue q; sums[3] = hold(q, delays); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms / 4-ary heap "; t0 = t;
+  { pads::d_ary_heap<key> q; sums[4] = hold(q, delays); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms" << std::endl;
+  for (int i = 1; i < 5; ++i) errors += (sums[i] != sums[0]);
+
+  const graph g = random_graph(r, V, 8);
+  std::vector<key> dists[4];
+  std::cout << "dijkstra " << V << " vertices : priority_queue ";
+  gettimeofday(&t0, 0);
+  { std::priority_queue<item, std::vector<item>, std::greater<item> > q; dists[0] = lazy_dijkstra(g, q); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms / pairing_heap (decrease_key) "; t0 = t;
+  dists[1] = pairing_dijkstra(g);
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms / radix_heap "; t0 = t;
+  { radix_items q; dists[2] = lazy_dijkstra(g, q); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms / 4-ary heap "; t0 = t;
+  { pads::d_ary_heap<item, 4, std::greater<item> > q; dists[3] = lazy_dijkstra(g, q); }
+  gettimeofday(&t, 0); std::cout << elapsed_ms(t0, t) << " ms" << std::endl;
+  for (int i = 1; i < 4; ++i) errors += (dists[i] != dists[0]);
+
+  if (errors) std::cout << "oops! " << errors << " errors" << std::endl;
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <vector>
+#include <sys/time.h>
+#include "integer.hpp"
+
+using pads::math::integer;
+
+// previous implementation, one bit per iteration
+integer reference_gcd(integer x, integer y)
+{
+  integer g = 1;
+  while (pads::math::even(x) && pads::math::even(y)) {
+    x >>= 1;
+    y >>= 1;
+    g <<= 1;
+  }
+  while (x) {
+    while (pads::math::even(x)) x >>= 1;
+    while (pads::math::even(y)) y >>= 1;
+    const integer t = pads::math::abs(x - y) / 2;
+    if (x >= y) {
+      x = t;
+    } else {
+      y = t;
+    }
+  }
+  return g * y;
+}
+
+static_assert(pads::math::gcd(48, 180) == 12, "gcd");
+static_assert(pads::math::lcm(4, 6) == 12, "lcm");
+static_assert(pads::math::modinv(3, 7) == 5, "modinv");
+
+int main(int argc, char* argv[])
+{
+  const size_t n = (argc > 1 ? ::atoi(argv[1]) : 1000000);
+  std::vector<integer> a(n), b(n), g(n);
+  ::srand48(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = (::lrand48() << 31 | ::lrand48()) + 1;
+    b[i] = (::lrand48() << 31 | ::lrand48()) + 1;
+  }
+
+  timeval t0, t;
+  integer sum = 0;
+  gettimeofday(&t0, 0);
+  for (size_t i = 0; i < n; ++i) sum += reference_gcd(a[i], b[i]);
+  gettimeofday(&t, 0); std::cout << "reference gcd : " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl; t0 = t;
+  for (size_t i = 0; i < n; ++i) sum -= pads::math::gcd(a[i], b[i]);
+  gettimeofday(&t, 0); std::cout << "pads::math::gcd : " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl; t0 = t;
+  for (size_t i = 0; i < n; ++i) sum += std::gcd(a[i], b[i]);
+  gettimeofday(&t, 0); std::cout << "std::gcd : " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl; t0 = t;
+  pads::math::batch_gcd(a.begin(), a.end(), b.begin(), g.begin());
+  gettimeofday(&t, 0); std::cout << "pads::math::batch_gcd : " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl; t0 = t;
+  for (size_t i = 0; i < n; ++i) sum -= g[i];
+  if (sum) std::cout << "oops! gcd" << std::endl;
+
+  const integer p = 1000000007;
+  std::vector<integer> inv(n);
+  for (size_t i = 0; i < n; ++i) inv[i] = pads::math::modinv(a[i], p);
+  gettimeofday(&t, 0); std::cout << "pads::math::modinv : " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl; t0 = t;
+  pads::math::batch_modinv(a.begin(), a.end(), p, g.begin());
+  gettimeofday(&t, 0); std::cout << "pads::math::batch_modinv : " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl;
+  for (size_t i = 0; i < n; ++i) {
+    if (inv[i] != g[i] || (inv[i] && pads::math::mulmod(a[i] % p, inv[i], p) != 1)) {
+      std::cout << "oops! modinv" << std::endl;
+      break;
+    }
+  }
+
+  return 0;
+}
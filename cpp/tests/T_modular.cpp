@@ -0,0 +1,88 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+#include "primes.hpp"
+
+using pads::math::integer;
+
+static_assert(pads::math::modexp(3, 1000000006, 1000000007) == 1, "modexp");
+static_assert(pow(pads::math::static_modular<998244353>(3), 998244352).value() == 1, "static_modular");
+
+// previous implementation: one hardware division per step
+integer division_modexp(integer a, integer b, integer n)
+{
+  integer x = 1;
+  for (a %= n; b; b >>= 1) {
+    if (b & 1) x = pads::math::mulmod(x, a, n);
+    a = pads::math::mulmod(a, a, n);
+  }
+  return x;
+}
+
+long elapsed_ms(const timeval& t0, const timeval& t)
+{
+  return 1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000;
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t n = (argc > 1 ? ::atoi(argv[1]) : 10000000);
+  const integer p = 1000000007, q = 4611686018427387847LL; // primes below 2^30 and 2^62
+  ::srand48(n);
+  std::vector<integer> a(n);
+  for (size_t i = 0; i < n; ++i) a[i] = ::lrand48();
+  timeval t0, t;
+  integer sum = 0;
+
+  // dependent chains of products modulo p
+  integer x = 1;
+  gettimeofday(&t0, 0);
+  for (size_t i = 0; i < n; ++i) x = pads::math::mulmod(x, a[i], p);
+  gettimeofday(&t, 0); std::cout << "mulmod : " << elapsed_ms(t0, t) << " ms" << std::endl; t0 = t;
+  typedef pads::math::modular<> residue;
+  residue::set_modulus(p);
+  residue y = 1;
+  for (size_t i = 0; i < n; ++i) y *= residue(a[i]);
+  gettimeofday(&t, 0); std::cout << "modular : " << elapsed_ms(t0, t) << " ms" << std::endl; t0 = t;
+  pads::math::static_modular<1000000007> z = 1;
+  for (size_t i = 0; i < n; ++i) z *= a[i];
+  gettimeofday(&t, 0); std::cout << "static_modular : " << elapsed_ms(t0, t) << " ms" << std::endl; t0 = t;
+  if (x != y.value() || x != z.value()) std::cout << "oops! modular" << std::endl;
+
+  // independent products modulo p, in batches
+  std::vector<uint32_t> u(a.begin(), a.end()), v(a.rbegin(), a.rend()), w(n);
+  gettimeofday(&t0, 0);
+  for (size_t i = 0; i < n; ++i) w[i] = (uint64_t) u[i] * v[i] % p;
+  gettimeofday(&t, 0); std::cout << "scalar % : " << elapsed_ms(t0, t) << " ms" << std::endl;
+  const pads::math::modular_batch batch(p);
+  batch.to(&u[0], &u[0], n);
+  batch.to(&v[0], &v[0], n);
+  gettimeofday(&t0, 0);
+  batch.mul(&u[0], &v[0], &u[0], n);
+  gettimeofday(&t, 0); std::cout << "modular_batch" <<
+#ifdef __AVX2__
+    " (AVX2)"
+#endif
+    " : " << elapsed_ms(t0, t) << " ms" << std::endl;
+  batch.from(&u[0], &u[0], n);
+  if (u != w) std::cout << "oops! modular_batch" << std::endl;
+
+  // modular exponentiation
+  gettimeofday(&t0, 0);
+  for (size_t i = 0; i < n / 100; ++i) sum += division_modexp(a[i], q - 1, q);
+  gettimeofday(&t, 0); std::cout << "division modexp : " << elapsed_ms(t0, t) << " ms" << std::endl; t0 = t;
+  for (size_t i = 0; i < n / 100; ++i) sum -= pads::math::modexp(a[i], q - 1, q);
+  gettimeofday(&t, 0); std::cout << "pads::math::modexp : " << elapsed_ms(t0, t) << " ms" << std::endl; t0 = t;
+  if (sum) std::cout << "oops! modexp" << std::endl;
+
+  const pads::math::primes primes;
+  size_t count = 0;
+  for (integer m = q; m < q + (integer) n / 10; m += 2) count += primes.fast_miller_rabin(m);
+  gettimeofday(&t, 0); std::cout << "fast_miller_rabin : " << count << " primes in " << elapsed_ms(t0, t) << " ms" << std::endl; t0 = t;
+
+  for (size_t i = 0; i < n / 1000; ++i) sum += pads::math::phi(((integer) a[i] << 31) + a[i+1]);
+  gettimeofday(&t, 0); std::cout << "phi : " << elapsed_ms(t0, t) << " ms" << std::endl;
+
+  return 0;
+}
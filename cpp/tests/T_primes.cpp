@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <sys/time.h>
+#include "primes.hpp"
+
+using pads::math::integer;
+
+static_assert(pads::math::is_prime(1000003) && !pads::math::is_prime(1000001), "is_prime");
+static_assert(pads::math::next_prime_v<1000> == 1009, "next_prime_v");
+static_assert(pads::math::prime_table<168>()[167] == 997, "prime_table");
+
+// counts the primes of [lo, hi[ with threads sharing one primes instance
+integer shared_count(const pads::math::primes& p, integer lo, integer hi, unsigned threads)
+{
+  std::vector<integer> counts(threads);
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.push_back(std::thread([&p, &counts, lo, hi, t, threads]() {
+      for (integer n = lo + t; n < hi; n += threads) counts[t] += p.is_prime(n);
+    }));
+  }
+  integer count = 0;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers[t].join();
+    count += counts[t];
+  }
+  return count;
+}
+
+int main(int argc, char* argv[])
+{
+  const integer max = (argc > 1 ? ::atoll(argv[1]) : 10000000000000LL);
+  timeval t0, t;
+
+  for (integer x = 10; x <= max; x *= 10) {
+    gettimeofday(&t0, 0);
+    const integer n = pads::math::prime_count(x);
+    gettimeofday(&t, 0);
+    std::cout << "pi(" << x << ") = " << n << " : " << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+  }
+
+  gettimeofday(&t0, 0);
+  const integer nth = pads::math::nth_prime(1000000000);
+  gettimeofday(&t, 0);
+  std::cout << "p(1e9) = " << nth << (nth != 22801763489LL ? " (oops!)" : "") << " : " << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+
+  const pads::math::primes primes;
+  const integer lo = 1000000000, hi = lo + 200000;
+  for (unsigned threads = 1; threads <= 2 * std::thread::hardware_concurrency(); threads *= 2) {
+    for (int pass = 0; pass < 2; ++pass) { // computed then cached
+      gettimeofday(&t0, 0);
+      const integer n = shared_count(primes, lo, hi, threads);
+      gettimeofday(&t, 0);
+      std::cout << "is_prime x " << threads << " threads" << (pass ? " (cached)" : "") << " : "
+                << n << " primes in " << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+    }
+  }
+
+  // next prime after random 62-bit numbers, then the same gaps by sieving
+  std::vector<integer> starts(100000);
+  for (size_t i = 0; i < starts.size(); ++i) starts[i] = ((integer) ::lrand48() << 31 ^ ::lrand48()) & 0x3fffffffffffffffLL;
+  integer sum = 0;
+  gettimeofday(&t0, 0);
+  for (size_t i = 0; i < starts.size(); ++i) sum += primes.next_prime(starts[i]);
+  gettimeofday(&t, 0);
+  std::cout << "next_prime x " << starts.size() << " : " << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms / constexpr ";
+  t0 = t;
+  for (size_t i = 0; i < starts.size(); ++i) sum -= pads::math::next_prime(starts[i]);
+  gettimeofday(&t, 0);
+  std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << (sum ? " (oops!)" : "") << std::endl;
+
+  std::vector<integer> range;
+  gettimeofday(&t0, 0);
+  primes.primes_in_range(1000000000000LL, 1000000000000LL + 100000000, std::back_inserter(range));
+  gettimeofday(&t, 0);
+  std::cout << "primes_in_range [1e12, 1e12+1e8[ : " << range.size() << " primes in "
+            << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+
+  // prime table file: written once, then mapped and queried against the
+  // computed answers
+  const char* path = "/tmp/T_primes.table";
+  const integer limit = 100000000;
+  gettimeofday(&t0, 0);
+  pads::math::prime_table_file::write(path, limit);
+  gettimeofday(&t, 0);
+  std::cout << "prime table below " << limit << " written in " << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms";
+  std::vector<integer> xs(100000), pis(xs.size()), ks(xs.size()), nths(xs.size());
+  for (size_t i = 0; i < xs.size(); ++i) {
+    xs[i] = ::lrand48() % limit;
+    ks[i] = 1 + ::lrand48() % 5000000;
+  }
+  for (size_t i = 0; i < 20; ++i) {
+    pis[i] = pads::math::prime_count(xs[i]);
+    nths[i] = pads::math::nth_prime(ks[i]);
+  }
+  integer computed = 0;
+  for (size_t i = 0; i < xs.size(); ++i) computed += primes.fast_miller_rabin(xs[i]);
+  gettimeofday(&t0, 0);
+  pads::math::primes::load(path);
+  gettimeofday(&t, 0);
+  std::cout << ", loaded in " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl;
+  const pads::math::prime_table_file& table = *pads::math::primes::loaded();
+  int errors = (table.pi(limit - 1) != 5761455);
+  for (size_t i = 0; i < 20; ++i) {
+    errors += (pads::math::prime_count(xs[i]) != pis[i]) + (pads::math::nth_prime(ks[i]) != nths[i]);
+  }
+  for (integer n = 0; n < 10000; ++n) errors += (table.pi(n) != table.pi(n - 1) + table.contains(n));
+  for (integer k = 1; k < 10000; ++k) errors += (table.pi(table.nth(k)) != k || !table.contains(table.nth(k)));
+  gettimeofday(&t0, 0);
+  for (size_t i = 0; i < xs.size(); ++i) computed -= primes.fast_miller_rabin(xs[i]);
+  gettimeofday(&t, 0);
+  std::cout << "table is_prime x " << xs.size() << " : " << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us / pi ";
+  t0 = t;
+  // explicit thread counts: hardware_concurrency() alone costs microseconds
+  for (size_t i = 0; i < xs.size(); ++i) sum += pads::math::prime_count(xs[i], 1);
+  gettimeofday(&t, 0);
+  std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us / nth ";
+  t0 = t;
+  for (size_t i = 0; i < ks.size(); ++i) sum += pads::math::nth_prime(ks[i], 1);
+  gettimeofday(&t, 0);
+  std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << (errors || computed ? " (oops!)" : "") << std::endl;
+  ::remove(path);
+
+  return 0;
+}
@@ -1,9 +1,13 @@
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <set>
 #include <vector>
 #include <cstdlib>
 #include <ctime>
+#include <random>
+#include <sys/time.h>
 #include "random.hpp"
 
 struct item
@@ -16,6 +20,27 @@ struct item
 
 typedef std::vector<item> items;
 
+// prints the elapsed time since t0 and the mean and variance of the samples
+void report(const char* name, timeval& t0, const std::vector<double>& v)
+{
+  timeval t;
+  gettimeofday(&t, 0);
+  if (v.empty()) {
+    std::cout << name << " : " << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+    gettimeofday(&t0, 0);
+    return;
+  }
+  double sum = 0, sum2 = 0;
+  for (size_t i = 0; i < v.size(); ++i) {
+    sum += v[i];
+    sum2 += v[i] * v[i];
+  }
+  const double mean = sum / v.size();
+  std::cout << name << " : " << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms, mean "
+            << mean << ", variance " << sum2 / v.size() - mean * mean << std::endl;
+  gettimeofday(&t0, 0);
+}
+
 int main(int argc, char* argv[])
 {
   size_t n = (argc > 1 ? ::atoi(argv[1]) : 100);
@@ -42,5 +67,115 @@ int main(int argc, char* argv[])
     std::cout << it->first << ": " << it->second << '\n';
   }
 
+  // non-uniform samplers, one by one and in bulk
+  const size_t m = 10 * 1000 * 1000;
+  std::vector<double> v(m);
+  pads::random::xoshiro256 engine(std::time(0));
+  pads::random::drand48_engine drand48;
+  std::mt19937_64 mt(std::time(0));
+  timeval t0;
+
+  gettimeofday(&t0, 0);
+  for (size_t i = 0; i < m; i += 2) { // Box-Muller
+    const double r = ::sqrt(-2 * ::log(1 - pads::random::generate())), a = 2 * M_PI * pads::random::generate();
+    v[i] = r * ::cos(a);
+    v[i+1] = r * ::sin(a);
+  }
+  report("normal Box-Muller/drand48", t0, v);
+  for (size_t i = 0; i < m; ++i) v[i] = pads::random::normal(drand48);
+  report("normal ziggurat/drand48  ", t0, v);
+  for (size_t i = 0; i < m; ++i) v[i] = pads::random::normal(engine);
+  report("normal ziggurat/xoshiro  ", t0, v);
+  pads::random::fill_normal(engine, v.begin(), m);
+  report("fill_normal/xoshiro      ", t0, v);
+
+  for (size_t i = 0; i < m; ++i) v[i] = -::log(1 - pads::random::generate());
+  report("exponential -log/drand48 ", t0, v);
+  for (size_t i = 0; i < m; ++i) v[i] = pads::random::exponential(engine);
+  report("exponential ziggurat     ", t0, v);
+  pads::random::fill_exponential(engine, v.begin(), m);
+  report("fill_exponential         ", t0, v);
+
+  static const double means[3] = { 4, 30, 1000 };
+  for (int k = 0; k < 3; ++k) {
+    std::poisson_distribution<long> poisson(means[k]);
+    std::cout << "poisson(" << means[k] << ")" << std::endl;
+    for (size_t i = 0; i < m; ++i) v[i] = poisson(mt);
+    report("  std::poisson_distribution", t0, v);
+    pads::random::fill_poisson(engine, v.begin(), m, means[k]);
+    report("  fill_poisson             ", t0, v);
+  }
+
+  static const double probabilities[2] = { 0.005, 0.3 };
+  for (int k = 0; k < 2; ++k) {
+    std::binomial_distribution<long> binomial(1000, probabilities[k]);
+    std::cout << "binomial(1000, " << probabilities[k] << ")" << std::endl;
+    for (size_t i = 0; i < m; ++i) v[i] = binomial(mt);
+    report("  std::binomial_distribution", t0, v);
+    pads::random::fill_binomial(engine, v.begin(), m, 1000, probabilities[k]);
+    report("  fill_binomial             ", t0, v);
+  }
+
+  // k of n without replacement, against a full shuffle truncated to k
+  v.clear();
+  const size_t population = 10 * 1000 * 1000;
+  std::vector<int> all(population);
+  std::vector<uint64_t> chosen;
+  static const size_t ks[3] = { 100, 10000, 1000000 };
+  for (int j = 0; j < 3; ++j) {
+    const size_t k = ks[j];
+    std::cout << k << " of " << population << std::endl;
+    gettimeofday(&t0, 0);
+    for (size_t i = 0; i < population; ++i) all[i] = i;
+    std::random_shuffle(all.begin(), all.end(), pads::random::rand);
+    all.resize(k);
+    all.resize(population);
+    report("  random_shuffle + truncation", t0, v);
+    chosen.clear();
+    pads::random::sample(engine, population, k, std::back_inserter(chosen));
+    report("  sample (Floyd)             ", t0, v);
+    if (std::set<uint64_t>(chosen.begin(), chosen.end()).size() != k) std::cout << "oops! sample" << std::endl;
+    chosen.clear();
+    pads::random::sample_sorted(engine, population, k, std::back_inserter(chosen));
+    report("  sample_sorted (Vitter D)   ", t0, v);
+    for (size_t i = 1; i < chosen.size(); ++i) {
+      if (chosen[i-1] >= chosen[i]) std::cout << "oops! sample_sorted" << std::endl;
+    }
+    if (chosen.size() != k || chosen.back() >= population) std::cout << "oops! sample_sorted" << std::endl;
+    for (size_t i = 0; i < population; ++i) all[i] = i;
+    gettimeofday(&t0, 0);
+    pads::random::reservoir_sample(engine, all.begin(), all.end(), k, chosen.begin());
+    report("  reservoir_sample (L)       ", t0, v);
+  }
+
+  // every position equally likely: 3 of 10, 10^6 times
+  std::vector<int> hits(10);
+  for (int i = 0; i < 1000000; ++i) {
+    uint64_t s[3];
+    pads::random::sample_sorted(engine, 10, 3, s);
+    for (int j = 0; j < 3; ++j) ++hits[s[j]];
+  }
+  std::cout << "sample_sorted 3 of 10 :";
+  for (int i = 0; i < 10; ++i) std::cout << ' ' << hits[i] / 1e6;
+  std::cout << std::endl;
+
+  // full permutations
+  gettimeofday(&t0, 0);
+  std::random_shuffle(all.begin(), all.end(), pads::random::rand);
+  report("random_shuffle  ", t0, v);
+  std::shuffle(all.begin(), all.end(), mt);
+  report("std::shuffle/mt ", t0, v);
+  pads::random::parallel_shuffle(all.begin(), all.end(), engine(), 1);
+  report("parallel_shuffle x 1", t0, v);
+  pads::random::parallel_shuffle(all.begin(), all.end(), engine());
+  report("parallel_shuffle", t0, v);
+  std::sort(all.begin(), all.end());
+  for (size_t i = 0; i < population; ++i) {
+    if (all[i] != (int) i) {
+      std::cout << "oops! parallel_shuffle" << std::endl;
+      break;
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,52 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+#include "sliding_average.hpp"
+
+const size_t S = 2 * 1000 * 1000; // series
+const int N = 16;                 // window
+
+long elapsed_ms(const timeval& t0, const timeval& t)
+{
+  return 1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000;
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t m = (argc > 1 ? ::atoi(argv[1]) : 20000000); // samples
+  std::vector<size_t> ids(m);
+  std::vector<double> values(m), means(S), table_means(S);
+  ::srand48(m);
+  for (size_t i = 0; i < m; ++i) {
+    ids[i] = ::lrand48() % S;
+    values[i] = ::drand48();
+  }
+  timeval t0, t;
+
+  gettimeofday(&t0, 0);
+  std::vector<sliding_average<double, N> > averages(S);
+  gettimeofday(&t, 0); std::cout << "sliding_average x " << S << " : create " << elapsed_ms(t0, t) << " ms"; t0 = t;
+  for (size_t i = 0; i < m; ++i) averages[ids[i]].add(values[i]);
+  gettimeofday(&t, 0); std::cout << ", add " << elapsed_ms(t0, t) << " ms"; t0 = t;
+  for (size_t i = 0; i < S; ++i) means[i] = averages[i].mean();
+  gettimeofday(&t, 0); std::cout << ", means " << elapsed_ms(t0, t) << " ms" << std::endl;
+
+  gettimeofday(&t0, 0);
+  sliding_average_table<double, N> table(S);
+  gettimeofday(&t, 0); std::cout << "sliding_average_table : create " << elapsed_ms(t0, t) << " ms"; t0 = t;
+  table.add(&ids[0], &values[0], m);
+  gettimeofday(&t, 0); std::cout << ", add " << elapsed_ms(t0, t) << " ms"; t0 = t;
+  table.means(&table_means[0]);
+  gettimeofday(&t, 0); std::cout << ", means " << elapsed_ms(t0, t) << " ms" << std::endl;
+
+  for (size_t i = 0; i < S; ++i) {
+    const double d = means[i] - table_means[i];
+    if (d > 1e-9 || d < -1e-9) {
+      std::cout << "oops! series " << i << std::endl;
+      break;
+    }
+  }
+
+  return 0;
+}
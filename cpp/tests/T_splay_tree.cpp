@@ -1,9 +1,151 @@
 #include "splay_tree.hpp"
+#include "persistent_treap.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
 #include <time.h>
+#include <sys/time.h>
 #include <tbb/tbb_allocator.h>
 
+const int N = 1 << 18;  // keys
+const int M = 1 << 20;  // lookups
+
+// keys drawn with probability ~ 1/rank^s
+std::vector<int> zipf_workload(pads::lcg& r, int n, int m, double s)
+{
+  std::vector<double> cdf(n);
+  double sum = 0;
+  for (int i = 0; i < n; ++i) cdf[i] = (sum += 1.0 / std::pow(i + 1.0, s));
+  std::vector<int> keys(n);
+  for (int i = 0; i < n; ++i) keys[i] = i;
+  std::random_shuffle(keys.begin(), keys.end());  // popular keys spread over the key space
+  std::vector<int> w(m);
+  for (int i = 0; i < m; ++i) {
+    w[i] = keys[std::lower_bound(cdf.begin(), cdf.end(), r.random_double() * sum) - cdf.begin()];
+  }
+  return w;
+}
+
+template<typename P>
+void bench_policy(const char* name, const std::vector<int>* workloads)
+{
+  static const char* const names[3] = { "uniform", "zipf", "sequential" };
+  std::cout << name << " :";
+  for (int w = 0; w < 3; ++w) {
+    pads::splay_tree<int, int, std::less<int>, std::allocator<pads::node<int, int> >, P> tree;
+    for (int i = 0; i < N; ++i) tree.insert(i, i);
+    const std::vector<int>& keys = workloads[w];
+    int found = 0;
+    timeval t0, t;
+    gettimeofday(&t0, 0);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      found += tree.contains(keys[i]);
+    }
+    gettimeofday(&t, 0);
+    std::cout << ' ' << names[w] << ' ' << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms";
+    if (found != M) std::cout << " (oops!)";
+  }
+  std::cout << std::endl;
+}
+
+void bench_batch(pads::lcg& r)
+{
+  pads::splay_tree<int, int> tree;
+  std::vector<std::pair<int, int> > pairs(N);
+  for (int i = 0; i < N; ++i) pairs[i] = std::make_pair(2 * i, i);
+  tree.insert_sorted(pairs.begin(), pairs.end());
+
+  std::vector<int> keys(M);
+  for (int i = 0; i < M; ++i) keys[i] = r.random_integer(0, 2 * N);
+  std::vector<int> sorted(keys);
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<int*> out(M);
+  int found = 0;
+  timeval t0, t;
+
+  std::cout << "sorted batch : contains ";
+  gettimeofday(&t0, 0);
+  for (int i = 0; i < M; ++i) found += tree.contains(sorted[i]);
+  gettimeofday(&t, 0); std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms / lookup_sorted "; t0 = t;
+  tree.lookup_sorted(sorted.begin(), sorted.end(), out.begin());
+  gettimeofday(&t, 0); std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+
+  std::cout << "random batch : contains ";
+  gettimeofday(&t0, 0);
+  for (int i = 0; i < M; ++i) found -= tree.contains(keys[i]);
+  gettimeofday(&t, 0); std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms / lookup "; t0 = t;
+  tree.lookup(keys.begin(), keys.end(), out.begin());
+  gettimeofday(&t, 0); std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+  if (found) std::cout << "oops!" << std::endl;
+}
+
+// save, streaming load and mapped lookups, against rebuilding by insertion
+void bench_image(pads::lcg& r)
+{
+  const int n = 1 << 21;
+  const char* path = "/tmp/T_splay_tree.image";
+  pads::splay_tree<int, int> tree;
+  std::vector<std::pair<int, int> > pairs(n);
+  for (int i = 0; i < n; ++i) pairs[i] = std::make_pair(3 * i, r.random_integer());
+  tree.insert_sorted(pairs.begin(), pairs.end());
+  const double mb = n * sizeof(pads::image_record<int, int>) / 1048576.0;
+  timeval t0, t;
+
+  std::cout << "image of " << n << " pairs : save ";
+  gettimeofday(&t0, 0);
+  {
+    std::ofstream os(path, std::ios::binary);
+    tree.save(os);
+  }
+  gettimeofday(&t, 0);
+  long us = 1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec);
+  std::cout << us / 1000 << " ms (" << (int) (mb * 1e6 / us) << " MB/s) / load ";
+  pads::splay_tree<int, int> loaded;
+  gettimeofday(&t0, 0);
+  {
+    std::ifstream is(path, std::ios::binary);
+    loaded.load(is);
+  }
+  gettimeofday(&t, 0);
+  us = 1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec);
+  std::cout << us / 1000 << " ms (" << (int) (mb * 1e6 / us) << " MB/s) / insert ";
+  std::vector<std::pair<int, int> > shuffled(pairs);
+  std::random_shuffle(shuffled.begin(), shuffled.end());
+  gettimeofday(&t0, 0);
+  pads::splay_tree<int, int> inserted;
+  for (int i = 0; i < n; ++i) inserted.insert(shuffled[i].first, shuffled[i].second);
+  gettimeofday(&t, 0); std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms / map ";
+  t0 = t;
+  const pads::tree_image<int, int> image(path);
+  gettimeofday(&t, 0); std::cout << (1000000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)) << " us" << std::endl;
+
+  std::vector<int> keys(M);
+  for (int i = 0; i < M; ++i) keys[i] = r.random_integer(0, 3 * n);
+  std::vector<int*> out(M);
+  long sum = 0;
+  std::cout << "image lookups : loaded tree ";
+  gettimeofday(&t0, 0);
+  loaded.lookup(keys.begin(), keys.end(), out.begin());
+  for (int i = 0; i < M; ++i) sum += (out[i] ? *out[i] : 0);
+  gettimeofday(&t, 0); std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms / mapped image ";
+  t0 = t;
+  for (int i = 0; i < M; ++i) {
+    const pads::image_record<int, int>* p = image.find(keys[i]);
+    sum -= (p ? p->value : 0);
+  }
+  gettimeofday(&t, 0); std::cout << (1000*(t.tv_sec-t0.tv_sec)+(t.tv_usec-t0.tv_usec)/1000) << " ms" << std::endl;
+
+  int errors = (loaded.size() != (size_t) n || image.size() != (size_t) n);
+  for (int i = 0; i < n; i += 1000) errors += (loaded[pairs[i].first] != pairs[i].second) + !image.contains(pairs[i].first);
+  if (sum || errors) std::cout << "oops!" << std::endl;
+  std::remove(path);
+}
+
 int main()
 {
   pads::lcg r(::time(0));
@@ -12,8 +154,48 @@ int main()
   for (int i = 0; i < 20; ++i) {
     tree.insert(i, r.random_integer());
   }
- 
+
   std::cout << tree << std::endl;
 
+  pads::splay_tree<int, int, std::less<int>, tbb::tbb_allocator<pads::node<int, int> > > copy(tree);
+  copy.remove(10);
+  std::cout << "copy: " << copy.contains(10) << " / tree: " << tree.contains(10) << std::endl;
+
+  // the owner keeps mutating while a reader walks a snapshot
+  pads::persistent_treap<int, int> treap;
+  for (int i = 0; i < 1000; ++i) {
+    treap.insert(i, i);
+  }
+  const pads::persistent_treap<int, int> snap = treap.snapshot();
+  int missing = 0;
+  std::thread reader([&snap, &missing]() {
+    for (int i = 0; i < 1000; ++i) {
+      const int* v = snap.find(i);
+      if (!v || *v != i) ++missing;
+    }
+  });
+  for (int i = 0; i < 1000; i += 2) {
+    treap.remove(i);
+    treap.insert(i + 1, -i);
+  }
+  reader.join();
+  std::cout << "snapshot: " << snap.size() << " keys, " << missing << " missing / treap: " << treap.size() << " keys" << std::endl;
+
+  // lookup workloads for the splaying policies
+  std::vector<int> workloads[3];
+  workloads[0].resize(M);
+  for (int i = 0; i < M; ++i) workloads[0][i] = r.random_integer(0, N - 1);
+  workloads[1] = zipf_workload(r, N, M, 0.99);
+  workloads[2].resize(M);
+  for (int i = 0; i < M; ++i) workloads[2][i] = i % N;
+
+  bench_policy<pads::full_splaying>("full splaying    ", workloads);
+  bench_policy<pads::semi_splaying>("semi splaying    ", workloads);
+  bench_policy<pads::random_splaying<10> >("random splaying  ", workloads);
+  bench_policy<pads::depth_splaying<2> >("depth splaying   ", workloads);
+
+  bench_batch(r);
+  bench_image(r);
+
   return 0;
 }
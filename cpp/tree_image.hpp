@@ -0,0 +1,257 @@
+#ifndef _TREE_IMAGE_HPP_
+#define _TREE_IMAGE_HPP_
+
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+#include "mapped_file.hpp"
+
+namespace pads {
+
+////////////////////////////////////////////////////////////////////////////////
+// Tree Images
+//
+// Binary serialization of ordered trees: a tree_image_header followed, at
+// offset record_offset, by the count records in increasing key order, as one
+// contiguous array of image_record<K, T> (image_record<K, void> for sets)
+// with zeroed padding. Keys and values must be trivially copyable; the byte
+// order and layout are those of the writing machine, and are checked by the
+// readers.
+
+template<typename K, typename T>
+struct image_record
+{
+  K key;
+  T value;
+};
+
+template<typename K>
+struct image_record<K, void>
+{
+  K key;
+};
+
+struct tree_image_header
+{
+  char magic[8];          // "PADSTREE"
+  uint32_t version;       // tree_image_version
+  uint32_t byte_order;    // 0x01020304 as written
+  uint64_t count;
+  uint32_t key_size;
+  uint32_t value_size;    // 0 for sets
+  uint32_t record_size;
+  uint32_t record_offset; // a multiple of 64
+};
+
+enum { tree_image_version = 1 };
+
+namespace detail {
+
+template<typename R>
+void check_image_header(const tree_image_header& h, size_t key_size, size_t value_size)
+{
+  if (std::memcmp(h.magic, "PADSTREE", 8) != 0) throw std::runtime_error("not a tree image");
+  if (h.version != tree_image_version || h.byte_order != 0x01020304) {
+    throw std::runtime_error("unsupported tree image version or byte order");
+  }
+  if (h.key_size != key_size || h.value_size != value_size || h.record_size != sizeof(R) ||
+      h.record_offset % 64 || h.record_offset < sizeof(tree_image_header)) {
+    throw std::runtime_error("tree image of another key or value type");
+  }
+}
+
+template<typename K, typename T>
+struct image_traits
+{
+  typedef image_record<K, T> record;
+  static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<T>::value,
+                "tree images need trivially copyable keys and values");
+  static_assert(alignof(record) <= 64, "tree image records are at most 64-byte aligned");
+  enum { key_size = sizeof(K), value_size = sizeof(T) };
+};
+
+template<typename K>
+struct image_traits<K, void>
+{
+  typedef image_record<K, void> record;
+  static_assert(std::is_trivially_copyable<K>::value, "tree images need trivially copyable keys");
+  static_assert(alignof(record) <= 64, "tree image records are at most 64-byte aligned");
+  enum { key_size = sizeof(K), value_size = 0 };
+};
+
+} // namespace detail
+
+///
+
+// Streams the records of an image to os through a fixed buffer: next() must
+// be called exactly count times, then finish().
+template<typename K, typename T = void>
+class image_writer
+{
+public:
+  typedef typename detail::image_traits<K, T>::record record;
+  enum { chunk = 4096 }; // records per write
+
+  image_writer(std::ostream& os, uint64_t count)
+    : os(os), buffer(chunk), used(0)
+  {
+    char header[64];
+    std::memset(header, 0, sizeof(header));
+    tree_image_header h;
+    std::memcpy(h.magic, "PADSTREE", 8);
+    h.version = tree_image_version;
+    h.byte_order = 0x01020304;
+    h.count = count;
+    h.key_size = detail::image_traits<K, T>::key_size;
+    h.value_size = detail::image_traits<K, T>::value_size;
+    h.record_size = sizeof(record);
+    h.record_offset = sizeof(header);
+    std::memcpy(header, &h, sizeof(h));
+    os.write(header, sizeof(header));
+  }
+
+  // The record to fill in; its padding is already zeroed.
+  record& next()
+  {
+    if (used == chunk) flush();
+    return buffer[used++];
+  }
+
+  void finish()
+  {
+    flush();
+    os.flush();
+    if (!os) throw std::runtime_error("cannot write tree image");
+  }
+
+private:
+  std::ostream& os;
+  std::vector<record> buffer; // value-initialized, padding included
+  size_t used;
+
+  void flush()
+  {
+    os.write(reinterpret_cast<const char*>(&buffer[0]), used * sizeof(record));
+    used = 0;
+  }
+};
+
+// Streams the records of an image from is through a fixed buffer. Throws
+// std::runtime_error on a malformed or truncated image.
+template<typename K, typename T = void>
+class image_reader
+{
+public:
+  typedef typename detail::image_traits<K, T>::record record;
+  enum { chunk = 4096 };
+
+  explicit image_reader(std::istream& is)
+    : is(is), buffer(chunk), remaining(0), used(0), available(0)
+  {
+    tree_image_header h;
+    if (!is.read(reinterpret_cast<char*>(&h), sizeof(h))) throw std::runtime_error("truncated tree image");
+    detail::check_image_header<record>(h, detail::image_traits<K, T>::key_size, detail::image_traits<K, T>::value_size);
+    is.ignore(h.record_offset - sizeof(h));
+    count = remaining = h.count;
+  }
+
+  uint64_t size() const { return count; }
+
+  const record& next()
+  {
+    if (used == available) fill();
+    return buffer[used++];
+  }
+
+private:
+  std::istream& is;
+  std::vector<record> buffer;
+  uint64_t count, remaining;
+  size_t used, available;
+
+  void fill()
+  {
+    available = (remaining < chunk ? remaining : chunk);
+    if (!available || !is.read(reinterpret_cast<char*>(&buffer[0]), available * sizeof(record))) {
+      throw std::runtime_error("truncated tree image");
+    }
+    remaining -= available;
+    used = 0;
+  }
+};
+
+///
+
+// Read-only view of an image file, mapped shared: lookups binary search the
+// records in place, so opening costs O(1) whatever the size, and processes
+// mapping the same file share its pages. C must order keys as the tree that
+// wrote the image.
+template<typename K, typename T = void, typename C = std::less<K> >
+class tree_image
+{
+public:
+  typedef typename detail::image_traits<K, T>::record record;
+  typedef const record* const_iterator;
+
+  explicit tree_image(const std::string& path)
+    : file(path)
+  {
+    tree_image_header h;
+    if (file.size() < sizeof(h)) throw std::runtime_error(path + " is not a tree image");
+    std::memcpy(&h, file.data(), sizeof(h));
+    detail::check_image_header<record>(h, detail::image_traits<K, T>::key_size, detail::image_traits<K, T>::value_size);
+    if (h.record_offset + h.count * sizeof(record) > file.size()) throw std::runtime_error(path + " is truncated");
+    records = reinterpret_cast<const record*>(file.data() + h.record_offset);
+    count = h.count;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return !count; }
+
+  const_iterator begin() const { return records; }
+  const_iterator end() const { return records + count; }
+
+  // The record holding k, or 0.
+  const record* find(const K& k) const
+  {
+    const_iterator r = lower_bound(k);
+    return (r != end() && !comp(k, r->key) ? r : 0);
+  }
+
+  bool contains(const K& k) const
+  {
+    return find(k) != 0;
+  }
+
+  // First record whose key is not less than k: branch-free halving, with
+  // both possible next probes prefetched.
+  const_iterator lower_bound(const K& k) const
+  {
+    if (!count) return records;
+    const record* base = records;
+    for (size_t n = count; n > 1; ) {
+      const size_t half = n / 2;
+      __builtin_prefetch(base + (n - half) / 2 - 1);
+      __builtin_prefetch(base + half + (n - half) / 2 - 1);
+      base = (comp(base[half - 1].key, k) ? base + half : base);
+      n -= half;
+    }
+    return base + comp(base->key, k);
+  }
+
+private:
+  mapped_file file;
+  const record* records;
+  size_t count;
+  C comp;
+};
+
+} // namespace pads
+
+#endif // _TREE_IMAGE_HPP_
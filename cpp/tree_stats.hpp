@@ -0,0 +1,115 @@
+#ifndef _TREE_STATS_HPP_
+#define _TREE_STATS_HPP_
+
+#include <cstddef>
+#include <ostream>
+
+namespace pads {
+
+////////////////////////////////////////////////////////////////////////////////
+// Instrumentation Policies for the Tree Containers
+//
+// Containers inherit privately from their policy and report their work through
+// the on_*() hooks. no_tree_stats is empty and its hooks are inline no-ops, so
+// a container using it has the same size and code as an uninstrumented one.
+
+enum tree_operation { op_find, op_insert, op_remove, op_count };
+
+struct no_tree_stats
+{
+  void on_rotation() const {}
+  void on_allocation() const {}
+  void on_deallocation() const {}
+  void on_operation(tree_operation, size_t) const {}
+};
+
+///
+
+class tree_stats
+{
+public:
+  enum { histogram_size = 8 * sizeof(size_t) + 1 };
+
+  tree_stats()
+  {
+    reset();
+  }
+
+  void on_rotation() const { ++rotations; }
+  void on_allocation() const { ++allocations; }
+  void on_deallocation() const { ++deallocations; }
+
+  // path is the number of nodes visited (and restructured, for splay trees)
+  void on_operation(tree_operation op, size_t path) const
+  {
+    ++operations[op];
+    path_length[op] += path;
+    if (path > max_depth) max_depth = path;
+    ++histogram[op][bucket(path)];
+  }
+
+  void reset()
+  {
+    rotations = allocations = deallocations = max_depth = 0;
+    for (int op = 0; op < op_count; ++op) {
+      operations[op] = path_length[op] = 0;
+      for (int i = 0; i < histogram_size; ++i) histogram[op][i] = 0;
+    }
+  }
+
+public:
+  size_t get_rotations() const { return rotations; }
+  size_t get_allocations() const { return allocations; }
+  size_t get_deallocations() const { return deallocations; }
+  size_t get_max_depth() const { return max_depth; }
+  size_t get_operations(tree_operation op) const { return operations[op]; }
+  size_t get_path_length(tree_operation op) const { return path_length[op]; }
+
+  // Number of operations whose path length p is in [2^(i-1), 2^i[ (0 for i = 0).
+  size_t get_histogram(tree_operation op, int i) const { return histogram[op][i]; }
+
+  static int bucket(size_t path)
+  {
+    int i = 0;
+    while (path) {
+      path >>= 1;
+      ++i;
+    }
+    return i;
+  }
+
+  void print(std::ostream& os) const
+  {
+    static const char* const names[op_count] = { "find", "insert", "remove" };
+    os << "rotations: " << rotations
+       << ", allocations: " << allocations
+       << ", deallocations: " << deallocations
+       << ", max depth: " << max_depth << '\n';
+    for (int op = 0; op < op_count; ++op) {
+      if (!operations[op]) continue;
+      os << names[op] << ": " << operations[op] << " ops, mean path "
+         << (double) path_length[op] / operations[op] << '\n';
+      for (int i = 0; i < histogram_size; ++i) {
+        if (histogram[op][i]) {
+          os << "  [" << (i ? (size_t) 1 << (i-1) : 0) << ", " << ((size_t) 1 << i) << "[ : "
+             << histogram[op][i] << '\n';
+        }
+      }
+    }
+  }
+
+private:
+  mutable size_t rotations;
+  mutable size_t allocations;
+  mutable size_t deallocations;
+  mutable size_t max_depth;
+  mutable size_t operations[op_count];
+  mutable size_t path_length[op_count];
+  mutable size_t histogram[op_count][histogram_size];
+};
+
+} // namespace pads
+
+inline std::ostream& operator<<(std::ostream& os, const pads::tree_stats& s) { s.print(os); return os; }
+
+#endif // _TREE_STATS_HPP_